@@ -5,12 +5,47 @@
 #include <iostream>
 #include <vector>
 #include <algorithm>
-#include <unordered_map>
 #include <string>
 #include <omp.h>
 #include <iomanip>
 #include <cstring>
 #include <chrono>
+#include <fstream>
+#include <sstream>
+#include <cctype>
+#include <cstdlib>
+#include <cstdint>
+#include <cstdio>
+#include <cmath>
+#include <deque>
+#include <memory>
+#include <filesystem>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <csignal>
+#include <cerrno>
+
+#ifdef _WIN32
+#define NOMINMAX
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#ifdef __linux__
+#include <sys/syscall.h>
+#include <linux/mempolicy.h>
+#ifdef XCROSS_INSTRUMENT
+#include <sys/ioctl.h>
+#include <linux/perf_event.h>
+#endif
+#endif
 
 // =========================================================================================
 // Timer Macros
@@ -57,71 +92,63 @@ std::vector<std::vector<int>> base_array2 = {
     {8, 7, 6, 5, 4, 3}
 };
 
-// Representation of a Cube State
-// cp: Corner Permutation, co: Corner Orientation
-// ep: Edge Permutation, eo: Edge Orientation
+// Representation of a Cube State, one byte per entry: the piece at each position (cp, ep)
+// and its orientation (co, eo). Applying a move M to X gives the piece that M brings to
+// position i from position M.ep[i], with M's twist or flip at i added.
 struct State {
-    std::vector<int> cp, co, ep, eo;
-
-    State(std::vector<int> c_p = {0, 1, 2, 3, 4, 5, 6, 7}, 
-          std::vector<int> c_o = {0, 0, 0, 0, 0, 0, 0, 0}, 
-          std::vector<int> e_p = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}, 
-          std::vector<int> e_o = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0}) 
-        : cp(c_p), co(c_o), ep(e_p), eo(e_o) {}
-
-    // Apply a move affecting specific edges
-    State apply_move_edge(const State& m, int e) const {
-        std::vector<int> nep(12, -1), neo(12, -1);
-        auto it = std::find(ep.begin(), ep.end(), e); 
-        int idx = std::distance(ep.begin(), it);
-        
-        it = std::find(m.ep.begin(), m.ep.end(), e); 
-        int idx_next = std::distance(m.ep.begin(), it);
-        
-        nep[idx_next] = e; 
-        neo[idx_next] = (eo[idx] + m.eo[idx_next]) % 2;
-        return State(cp, co, nep, neo);
+    uint8_t cp[8], co[8], ep[12], eo[12];
+
+    static constexpr State solved() {
+        State s{};
+        for (int i = 0; i < 8; ++i) s.cp[i] = i;
+        for (int i = 0; i < 12; ++i) s.ep[i] = i;
+        return s;
     }
 
-    // Apply a move affecting specific corners
-    State apply_move_corner(const State& m, int c) const {
-        std::vector<int> ncp(8, -1), nco(8, -1);
-        auto it = std::find(cp.begin(), cp.end(), c); 
-        int idx = std::distance(cp.begin(), it);
-        
-        it = std::find(m.cp.begin(), m.cp.end(), c); 
-        int idx_next = std::distance(m.cp.begin(), it);
-        
-        ncp[idx_next] = c; 
-        nco[idx_next] = (co[idx] + m.co[idx_next]) % 3;
-        return State(ncp, nco, ep, eo);
-    }
-};
-
-// Definition of basic moves and their effect on the cube state
-std::unordered_map<std::string, State> moves_map = {
-    {"U", State({3,0,1,2,4,5,6,7}, {0,0,0,0,0,0,0,0}, {0,1,2,3,7,4,5,6,8,9,10,11}, {0,0,0,0,0,0,0,0,0,0,0,0})},
-    {"U2", State({2,3,0,1,4,5,6,7}, {0,0,0,0,0,0,0,0}, {0,1,2,3,6,7,4,5,8,9,10,11}, {0,0,0,0,0,0,0,0,0,0,0,0})},
-    {"U'", State({1,2,3,0,4,5,6,7}, {0,0,0,0,0,0,0,0}, {0,1,2,3,5,6,7,4,8,9,10,11}, {0,0,0,0,0,0,0,0,0,0,0,0})},
-    {"D", State({0,1,2,3,5,6,7,4}, {0,0,0,0,0,0,0,0}, {0,1,2,3,4,5,6,7,9,10,11,8}, {0,0,0,0,0,0,0,0,0,0,0,0})},
-    {"D2", State({0,1,2,3,6,7,4,5}, {0,0,0,0,0,0,0,0}, {0,1,2,3,4,5,6,7,10,11,8,9}, {0,0,0,0,0,0,0,0,0,0,0,0})},
-    {"D'", State({0,1,2,3,7,4,5,6}, {0,0,0,0,0,0,0,0}, {0,1,2,3,4,5,6,7,11,8,9,10}, {0,0,0,0,0,0,0,0,0,0,0,0})},
-    {"L", State({4,1,2,0,7,5,6,3}, {2,0,0,1,1,0,0,2}, {11,1,2,7,4,5,6,0,8,9,10,3}, {0,0,0,0,0,0,0,0,0,0,0,0})},
-    {"L2", State({7,1,2,4,3,5,6,0}, {0,0,0,0,0,0,0,0}, {3,1,2,0,4,5,6,11,8,9,10,7}, {0,0,0,0,0,0,0,0,0,0,0,0})},
-    {"L'", State({3,1,2,7,0,5,6,4}, {2,0,0,1,1,0,0,2}, {7,1,2,11,4,5,6,3,8,9,10,0}, {0,0,0,0,0,0,0,0,0,0,0,0})},
-    {"R", State({0,2,6,3,4,1,5,7}, {0,1,2,0,0,2,1,0}, {0,5,9,3,4,2,6,7,8,1,10,11}, {0,0,0,0,0,0,0,0,0,0,0,0})},
-    {"R2", State({0,6,5,3,4,2,1,7}, {0,0,0,0,0,0,0,0}, {0,2,1,3,4,9,6,7,8,5,10,11}, {0,0,0,0,0,0,0,0,0,0,0,0})},
-    {"R'", State({0,5,1,3,4,6,2,7}, {0,1,2,0,0,2,1,0}, {0,9,5,3,4,1,6,7,8,2,10,11}, {0,0,0,0,0,0,0,0,0,0,0,0})},
-    {"F", State({0,1,3,7,4,5,2,6}, {0,0,1,2,0,0,2,1}, {0,1,6,10,4,5,3,7,8,9,2,11}, {0,0,1,1,0,0,1,0,0,0,1,0})},
-    {"F2", State({0,1,7,6,4,5,3,2}, {0,0,0,0,0,0,0,0}, {0,1,3,2,4,5,10,7,8,9,6,11}, {0,0,0,0,0,0,0,0,0,0,0,0})},
-    {"F'", State({0,1,6,2,4,5,7,3}, {0,0,1,2,0,0,2,1}, {0,1,10,6,4,5,2,7,8,9,3,11}, {0,0,1,1,0,0,1,0,0,0,1,0})},
-    {"B", State({1,5,2,3,0,4,6,7}, {1,2,0,0,2,1,0,0}, {4,8,2,3,1,5,6,7,0,9,10,11}, {1,1,0,0,1,0,0,0,1,0,0,0})},
-    {"B2", State({5,4,2,3,1,0,6,7}, {0,0,0,0,0,0,0,0}, {1,0,2,3,8,5,6,7,4,9,10,11}, {0,0,0,0,0,0,0,0,0,0,0,0})},
-    {"B'", State({4,0,2,3,5,1,6,7}, {1,2,0,0,2,1,0,0}, {8,4,2,3,0,5,6,7,1,9,10,11}, {1,1,0,0,1,0,0,0,1,0,0,0})}
+    constexpr State apply_move(const State& m) const {
+        State n{};
+        for (int i = 0; i < 8; ++i) {
+            n.cp[i] = cp[m.cp[i]];
+            n.co[i] = (co[m.cp[i]] + m.co[i]) % 3;
+        }
+        for (int i = 0; i < 12; ++i) {
+            n.ep[i] = ep[m.ep[i]];
+            n.eo[i] = (eo[m.ep[i]] + m.eo[i]) % 2;
+        }
+        return n;
+    }
+
+    // Position of corner / edge piece 'p'
+    constexpr int corner_pos(int p) const { int i = 0; while (cp[i] != p) ++i; return i; }
+    constexpr int edge_pos(int p) const { int i = 0; while (ep[i] != p) ++i; return i; }
+};
+
+// Quarter turns of the faces U, D, L, R, F, B; the half and inverse turns are their powers
+constexpr State face_turns[6] = {
+    {{3,0,1,2,4,5,6,7}, {0,0,0,0,0,0,0,0}, {0,1,2,3,7,4,5,6,8,9,10,11}, {0,0,0,0,0,0,0,0,0,0,0,0}},
+    {{0,1,2,3,5,6,7,4}, {0,0,0,0,0,0,0,0}, {0,1,2,3,4,5,6,7,9,10,11,8}, {0,0,0,0,0,0,0,0,0,0,0,0}},
+    {{4,1,2,0,7,5,6,3}, {2,0,0,1,1,0,0,2}, {11,1,2,7,4,5,6,0,8,9,10,3}, {0,0,0,0,0,0,0,0,0,0,0,0}},
+    {{0,2,6,3,4,1,5,7}, {0,1,2,0,0,2,1,0}, {0,5,9,3,4,2,6,7,8,1,10,11}, {0,0,0,0,0,0,0,0,0,0,0,0}},
+    {{0,1,3,7,4,5,2,6}, {0,0,1,2,0,0,2,1}, {0,1,6,10,4,5,3,7,8,9,2,11}, {0,0,1,1,0,0,1,0,0,0,1,0}},
+    {{1,5,2,3,0,4,6,7}, {1,2,0,0,2,1,0,0}, {4,8,2,3,1,5,6,7,0,9,10,11}, {1,1,0,0,1,0,0,0,1,0,0,0}}
+};
+
+struct MoveStates {
+    State m[18];
+    constexpr MoveStates() : m{} {
+        for (int f = 0; f < 6; ++f) {
+            State s = State::solved();
+            for (int pow = 0; pow < 3; ++pow) m[3 * f + pow] = s = s.apply_move(face_turns[f]);
+        }
+    }
 };
 
+// Effect of each move, in move_names order
+constexpr MoveStates move_states;
+
+// Reference ranking (original implementation, kept for --verify-rank)
 // Convert a permutation array to a unique integer index (Coordinate compression)
-inline int array_to_index(std::vector<int> &a, int n, int c, int pn) {
+inline int array_to_index_ref(std::vector<int> &a, int n, int c, int pn) {
     int idx_p = 0, idx_o = 0, tmp, tmp2 = 24 / pn;
     // Calculate Orientation Index
     for (int i = 0; i < n; ++i) { 
@@ -138,7 +165,7 @@ inline int array_to_index(std::vector<int> &a, int n, int c, int pn) {
 }
 
 // Convert a unique integer index back to a permutation array
-inline void index_to_array(std::vector<int> &p, int index, int n, int c, int pn) {
+inline void index_to_array_ref(std::vector<int> &p, int index, int n, int c, int pn) {
     int tmp2 = 24 / pn, p_idx = index / c_array[c][n], o_idx = index % c_array[c][n];
     std::vector<int> local_sorted(n);
     // Recover Permutation
@@ -156,22 +183,97 @@ inline void index_to_array(std::vector<int> &p, int index, int n, int c, int pn)
     }
 }
 
+// Lookup tables for allocation-free ranking: orientation powers, falling factorials
+// pn * (pn - 1) * ... (k factors) and the k-th free position of a 12-bit occupancy mask
+struct RankTables {
+    int pow_c[4][13];
+    int falling[13][13];
+    unsigned char select_free[1 << 12][12];
+
+    constexpr RankTables() : pow_c(), falling(), select_free() {
+        for (int c = 1; c < 4; ++c) {
+            pow_c[c][0] = 1;
+            for (int k = 1; k < 13; ++k) pow_c[c][k] = pow_c[c][k - 1] * c;
+        }
+        for (int pn = 0; pn < 13; ++pn) {
+            falling[pn][0] = 1;
+            for (int k = 1; k <= pn; ++k) falling[pn][k] = falling[pn][k - 1] * (pn - k + 1);
+        }
+        for (int mask = 0; mask < (1 << 12); ++mask) {
+            int k = 0;
+            for (int pos = 0; pos < 12; ++pos) if (!((mask >> pos) & 1)) select_free[mask][k++] = pos;
+        }
+    }
+};
+constexpr RankTables rank_tables;
+
+// Convert a piece array (c * position + orientation per piece) to its coordinate.
+// The permutation digit of piece i is its position among the positions still free,
+// counted with a popcount over the mask of positions taken by pieces 0 .. i-1.
+inline int array_to_index(const int* a, int n, int c, int pn) {
+    int idx_p = 0, idx_o = 0, used = 0;
+    for (int i = 0; i < n; ++i) {
+        int pos = a[i] / c;
+        idx_o = idx_o * c + a[i] % c;
+        idx_p += (pos - __builtin_popcount(used & ((1 << pos) - 1))) * rank_tables.falling[pn][i];
+        used |= 1 << pos;
+    }
+    return idx_p * rank_tables.pow_c[c][n] + idx_o;
+}
+
+// Convert a coordinate back to a piece array, scaled by 18 for move table lookups
+inline void index_to_array(int* p, int index, int n, int c, int pn) {
+    int p_idx = index / rank_tables.pow_c[c][n], o_idx = index % rank_tables.pow_c[c][n], used = 0;
+    for (int i = 0; i < n; ++i) {
+        int pos = rank_tables.select_free[used][p_idx % (pn - i)];
+        p_idx /= pn - i;
+        used |= 1 << pos;
+        p[i] = pos;
+    }
+    for (int i = n - 1; i >= 0; --i) {
+        p[i] = 18 * (c * p[i] + o_idx % c);
+        o_idx /= c;
+    }
+}
+
+// Round trip every index of the coordinates used in this program through the ranking above
+// and compare with the reference implementation
+bool verify_ranking() {
+    const int configs[][3] = {{1, 2, 12}, {1, 3, 8}, {2, 2, 12}, {2, 3, 8}, {4, 2, 12}, {4, 3, 8}};
+    bool all_ok = true;
+    for (const auto &cfg : configs) {
+        int n = cfg[0], c = cfg[1], pn = cfg[2];
+        int size = rank_tables.falling[pn][n] * rank_tables.pow_c[c][n];
+        std::vector<int> ref(n), ref_a(n);
+        int p[12], a[12];
+        long long errors = 0;
+        for (int index = 0; index < size; ++index) {
+            index_to_array(p, index, n, c, pn);
+            index_to_array_ref(ref, index, n, c, pn);
+            for (int i = 0; i < n; ++i) {
+                if (p[i] != ref[i]) { errors++; break; }
+                a[i] = ref_a[i] = p[i] / 18;
+            }
+            if (array_to_index(a, n, c, pn) != index || array_to_index_ref(ref_a, n, c, pn) != index) errors++;
+        }
+        std::cout << "[Verify] Ranking (n=" << n << ", c=" << c << ", pn=" << pn << "): " << size 
+                  << " indices, " << errors << " mismatches" << std::endl;
+        all_ok = all_ok && errors == 0;
+    }
+    return all_ok;
+}
+
 // Generate Edge Move Table
 std::vector<int> create_edge_move_table() {
     std::vector<int> mt(24 * 18, -1);
     for (int i = 0; i < 24; ++i) {
-        State s; 
-        s.ep = {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11}; 
-        s.eo = {0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0, 0};
-        
         // Setup initial state for edge 'i/2' with orientation 'i%2'
-        s.ep[i / 2] = i / 2; 
+        State s = State::solved();
         s.eo[i / 2] = i % 2;
         
         for (int j = 0; j < 18; ++j) {
-            State ns = s.apply_move_edge(moves_map[move_names[j]], i / 2);
-            auto it = std::find(ns.ep.begin(), ns.ep.end(), i / 2);
-            int idx = std::distance(ns.ep.begin(), it);
+            State ns = s.apply_move(move_states.m[j]);
+            int idx = ns.edge_pos(i / 2);
             mt[18 * i + j] = 2 * idx + ns.eo[idx];
         }
     }
@@ -182,18 +284,13 @@ std::vector<int> create_edge_move_table() {
 std::vector<int> create_corner_move_table() {
     std::vector<int> mt(24 * 18, -1);
     for (int i = 0; i < 24; ++i) {
-        State s; 
-        s.cp = {0, 1, 2, 3, 4, 5, 6, 7}; 
-        s.co = {0, 0, 0, 0, 0, 0, 0, 0};
-        
         // Setup initial state for corner 'i/3' with orientation 'i%3'
-        s.cp[i / 3] = i / 3; 
+        State s = State::solved();
         s.co[i / 3] = i % 3;
         
         for (int j = 0; j < 18; ++j) {
-            State ns = s.apply_move_corner(moves_map[move_names[j]], i / 3);
-            auto it = std::find(ns.cp.begin(), ns.cp.end(), i / 3);
-            int idx = std::distance(ns.cp.begin(), it);
+            State ns = s.apply_move(move_states.m[j]);
+            int idx = ns.corner_pos(i / 3);
             mt[18 * i + j] = 3 * idx + ns.co[idx];
         }
     }
@@ -203,7 +300,7 @@ std::vector<int> create_corner_move_table() {
 // Generate Multi-piece Move Table (Combined coordinate)
 std::vector<int> create_multi_move_table(int n, int c, int pn, int size, const std::vector<int> &basic_t) {
     std::vector<int> mt(size * 24, -1);
-    std::vector<int> a(n), b(n);
+    int a[12], b[12];
     // Inverse move indices for optimization
     std::vector<int> inv = {2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 17, 16, 15};
     
@@ -227,67 +324,589 @@ std::vector<int> create_multi_move_table(int n, int c, int pn, int size, const s
 }
 
 // =========================================================================================
-// PART 2: Fixed Distance Table (Dual: BL and BR)
+// PART 2: Table Storage & Persistence (Memory-Mapped Binary Files)
+// =========================================================================================
+
+// Directory holding the cached move/pruning tables, and a switch to ignore the cache
+std::string table_dir = ".";
+bool force_regen = false;
+
+// On-disk layout: a fixed header followed by the raw payload at TABLE_PAYLOAD_OFFSET.
+// The payload is page aligned so the mapping can be used directly as the table.
+const char TABLE_MAGIC[8] = {'X', 'C', 'R', 'O', 'S', 'S', 'T', 'B'};
+const uint32_t TABLE_VERSION = 2;
+const size_t TABLE_PAYLOAD_OFFSET = 4096;
+
+struct TableHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t elem_bits;   // Bits per element (4 for packed pruning tables)
+    uint64_t elem_count;  // Number of elements in the payload
+    int64_t dims[3];      // Coordinate sizes (sz_cr, sz_cn, sz_ed), 0 if unused
+    int32_t start[3];     // BFS start indices (idx_cr, idx_cn, idx_ed); move tables: MoveTableKind, -1, -1
+    uint32_t d_offsets;   // D-layer offsets accepted as solved (0 for a single start state)
+    uint64_t checksum;    // Checksum of the payload
+};
+
+// Move tables of equal shape are told apart by their kind, so swapped files fail validation
+enum MoveTableKind { MoveTableEdge = 1, MoveTableCorner = 2, MoveTableCross = 3 };
+
+// Build the header describing a table (checksum is filled in when saving)
+TableHeader make_table_header(uint32_t elem_bits, uint64_t elem_count, 
+    int64_t d0, int64_t d1, int64_t d2, int32_t s0 = -1, int32_t s1 = -1, int32_t s2 = -1) 
+{
+    TableHeader h;
+    std::memset(&h, 0, sizeof(h));
+    std::memcpy(h.magic, TABLE_MAGIC, sizeof(TABLE_MAGIC));
+    h.version = TABLE_VERSION;
+    h.elem_bits = elem_bits;
+    h.elem_count = elem_count;
+    h.dims[0] = d0; h.dims[1] = d1; h.dims[2] = d2;
+    h.start[0] = s0; h.start[1] = s1; h.start[2] = s2;
+    return h;
+}
+
+// 64-bit checksum over the payload (word-wise multiply/xor mix)
+uint64_t table_checksum(const unsigned char* p, size_t n) {
+    uint64_t h = 0x9E3779B97F4A7C15ULL ^ n;
+    size_t i = 0;
+    for (; i + 8 <= n; i += 8) {
+        uint64_t w;
+        std::memcpy(&w, p + i, 8);
+        h = (h ^ w) * 0x100000001B3ULL;
+        h ^= h >> 29;
+    }
+    for (; i < n; ++i) {
+        h = (h ^ p[i]) * 0x100000001B3ULL;
+    }
+    return h ^ (h >> 32);
+}
+
+// Placement of table memory: first-touch (filled in parallel, pages land on the node of the
+// touching thread), interleaved page by page over all nodes, or one replica per node. Huge
+// pages are requested through THP (madvise) or explicitly (MAP_HUGETLB, falling back to THP).
+enum class NumaPolicy { FirstTouch, Interleave, Replicate };
+enum class HugePages { Off, Transparent, Explicit };
+NumaPolicy numa_policy = NumaPolicy::FirstTouch;
+HugePages huge_pages = HugePages::Off;
+const size_t huge_page_size = 2 << 20;
+
+// Number of NUMA nodes (highest online node + 1), 1 when unknown
+int numa_node_count() {
+    static int nodes = 0;
+    if (nodes > 0) return nodes;
+    nodes = 1;
+#ifdef __linux__
+    std::ifstream in("/sys/devices/system/node/online");
+    std::string list;
+    if (in >> list) {
+        // Format: "0", "0-1", "0,2-3"
+        for (char &ch : list) if (!std::isdigit((unsigned char)ch)) ch = ' ';
+        std::istringstream ss(list);
+        int node;
+        while (ss >> node) nodes = std::max(nodes, node + 1);
+    }
+#endif
+    return nodes;
+}
+
+// NUMA node of the calling thread (looked up once per thread)
+inline int current_numa_node() {
+#ifdef __linux__
+    static thread_local int node = -1;
+    if (node < 0) {
+        unsigned cpu = 0, n = 0;
+        node = (syscall(SYS_getcpu, &cpu, &n, nullptr) == 0) ? (int)n : 0;
+    }
+    return node;
+#else
+    return 0;
+#endif
+}
+
+// Apply an mbind policy to [addr, addr + len) before it is touched; node < 0 means all nodes
+bool bind_memory(void* addr, size_t len, int mode, int node) {
+#ifdef __linux__
+    unsigned long mask[4] = {0};
+    int nodes = std::min(numa_node_count(), (int)(8 * sizeof(mask)));
+    for (int n = 0; n < nodes; ++n) {
+        if (node < 0 || n == node) mask[n / (8 * sizeof(unsigned long))] |= 1UL << (n % (8 * sizeof(unsigned long)));
+    }
+    return syscall(SYS_mbind, addr, len, mode, mask, 8 * sizeof(mask), 0) == 0;
+#else
+    (void)addr; (void)len; (void)mode; (void)node;
+    return false;
+#endif
+}
+
+// Raw byte storage for a table: either owned memory (placed according to numa_policy /
+// huge_pages) or a read-only file mapping
+class TableBuffer {
+public:
+    TableBuffer() = default;
+    ~TableBuffer() { release(); }
+    TableBuffer(const TableBuffer&) = delete;
+    TableBuffer& operator=(const TableBuffer&) = delete;
+
+    // Allocate storage filled with 'fill'. The fill runs in parallel so first-touch spreads the
+    // pages over the nodes of the worker threads; 'node' >= 0 binds the pages to that node.
+    unsigned char* allocate(size_t bytes, unsigned char fill, int node = -1) {
+        release();
+#ifdef _WIN32
+        owned.assign(bytes, fill);
+        ptr = owned.data();
+#else
+        size_t alloc_len = huge_pages == HugePages::Off ? bytes : (bytes + huge_page_size - 1) / huge_page_size * huge_page_size;
+        void* base = MAP_FAILED;
+#ifdef MAP_HUGETLB
+        if (huge_pages == HugePages::Explicit) {
+            base = mmap(nullptr, alloc_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS | MAP_HUGETLB, -1, 0);
+            if (base == MAP_FAILED) std::cout << " [MAP_HUGETLB failed, using THP]" << std::flush;
+        }
+#endif
+        if (base == MAP_FAILED) {
+            base = mmap(nullptr, alloc_len, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+            if (base == MAP_FAILED) throw std::bad_alloc();
+#ifdef MADV_HUGEPAGE
+            if (huge_pages != HugePages::Off) madvise(base, alloc_len, MADV_HUGEPAGE);
+#endif
+        }
+#ifdef __linux__
+        if (node >= 0) bind_memory(base, alloc_len, MPOL_BIND, node);
+        else if (numa_policy == NumaPolicy::Interleave) bind_memory(base, alloc_len, MPOL_INTERLEAVE, -1);
+#endif
+        anon_base = base;
+        anon_len = alloc_len;
+        ptr = static_cast<unsigned char*>(base);
+        const long long chunks = (long long)((bytes + huge_page_size - 1) / huge_page_size);
+        #pragma omp parallel for schedule(static)
+        for (long long c = 0; c < chunks; ++c) {
+            size_t begin = (size_t)c * huge_page_size;
+            std::memset(ptr + begin, fill, std::min(huge_page_size, bytes - begin));
+        }
+#endif
+        len = bytes;
+        return ptr;
+    }
+
+    // Copy 'src' into storage allocated as above (bound to 'node' if >= 0)
+    void copy_from(const TableBuffer &src, int node = -1) {
+        allocate(src.size(), 0, node);
+        parallel_copy(src.data());
+    }
+
+    // Replace a file mapping by an owned copy
+    void make_resident() {
+        if (!map_base) return;
+        void* old_base = map_base;
+        size_t old_len = map_len;
+        const unsigned char* src = ptr;
+        size_t bytes = len;
+        map_base = nullptr; // Keep the mapping alive through allocate()
+        allocate(bytes, 0);
+        parallel_copy(src);
+#ifdef _WIN32
+        UnmapViewOfFile(old_base);
+        (void)old_len;
+#else
+        munmap(old_base, old_len);
+#endif
+    }
+
+    // Map a whole file read-only; the payload starts at 'offset'
+    bool map_file(const std::string &path, size_t offset) {
+        release();
+#ifdef _WIN32
+        HANDLE fh = CreateFileA(path.c_str(), GENERIC_READ, FILE_SHARE_READ, NULL, 
+                                OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, NULL);
+        if (fh == INVALID_HANDLE_VALUE) return false;
+        LARGE_INTEGER fsize;
+        if (!GetFileSizeEx(fh, &fsize) || (size_t)fsize.QuadPart < offset) { CloseHandle(fh); return false; }
+        HANDLE mh = CreateFileMappingA(fh, NULL, PAGE_READONLY, 0, 0, NULL);
+        CloseHandle(fh);
+        if (mh == NULL) return false;
+        void* base = MapViewOfFile(mh, FILE_MAP_READ, 0, 0, 0);
+        CloseHandle(mh); // The view keeps the mapping alive
+        if (base == NULL) return false;
+        size_t fbytes = (size_t)fsize.QuadPart;
+#else
+        int fd = open(path.c_str(), O_RDONLY);
+        if (fd < 0) return false;
+        struct stat st;
+        if (fstat(fd, &st) != 0 || (size_t)st.st_size < offset || st.st_size == 0) { close(fd); return false; }
+        size_t fbytes = (size_t)st.st_size;
+        void* base = mmap(nullptr, fbytes, PROT_READ, MAP_SHARED, fd, 0);
+        close(fd); // The mapping stays valid after closing the descriptor
+        if (base == MAP_FAILED) return false;
+#endif
+        map_base = base;
+        map_len = fbytes;
+        ptr = static_cast<unsigned char*>(base) + offset;
+        len = fbytes - offset;
+        return true;
+    }
+
+    void release() {
+        if (map_base) {
+#ifdef _WIN32
+            UnmapViewOfFile(map_base);
+#else
+            munmap(map_base, map_len);
+#endif
+            map_base = nullptr;
+            map_len = 0;
+        }
+#ifndef _WIN32
+        if (anon_base) munmap(anon_base, anon_len);
+        anon_base = nullptr;
+        anon_len = 0;
+#endif
+        std::vector<unsigned char>().swap(owned);
+        ptr = nullptr;
+        len = 0;
+    }
+
+    // Header bytes in front of the payload (only meaningful for mapped files)
+    const unsigned char* mapped_base() const { return static_cast<const unsigned char*>(map_base); }
+
+    const unsigned char* data() const { return ptr; }
+    unsigned char* mutable_data() { return map_base ? nullptr : ptr; }
+    size_t size() const { return len; }
+
+private:
+    unsigned char* ptr = nullptr;
+    size_t len = 0;
+    std::vector<unsigned char> owned;
+    void* anon_base = nullptr;
+    size_t anon_len = 0;
+    void* map_base = nullptr;
+    size_t map_len = 0;
+
+    void parallel_copy(const unsigned char* src) {
+        const long long chunks = (long long)((len + huge_page_size - 1) / huge_page_size);
+        #pragma omp parallel for schedule(static)
+        for (long long c = 0; c < chunks; ++c) {
+            size_t begin = (size_t)c * huge_page_size;
+            std::memcpy(ptr + begin, src + begin, std::min(huge_page_size, len - begin));
+        }
+    }
+};
+
+std::string table_path(const std::string &file_name) {
+    return table_dir + "/" + file_name;
+}
+
+// Atomically move a fully written temporary file over 'path'
+bool replace_file(const std::string &tmp_path, const std::string &path) {
+#ifdef _WIN32
+    bool ok = MoveFileExA(tmp_path.c_str(), path.c_str(), MOVEFILE_REPLACE_EXISTING) != 0;
+#else
+    bool ok = std::rename(tmp_path.c_str(), path.c_str()) == 0;
+#endif
+    if (!ok) std::remove(tmp_path.c_str());
+    return ok;
+}
+
+// Write header + payload to a temporary file, then rename it into place so that
+// concurrent readers never observe a partially written table
+bool save_table(const std::string &path, TableHeader header, const void* payload, size_t bytes) {
+    header.checksum = table_checksum(static_cast<const unsigned char*>(payload), bytes);
+    std::string tmp_path = path + ".tmp";
+    FILE* f = std::fopen(tmp_path.c_str(), "wb");
+    if (!f) return false;
+    
+    std::vector<unsigned char> head(TABLE_PAYLOAD_OFFSET, 0);
+    std::memcpy(head.data(), &header, sizeof(header));
+    bool ok = std::fwrite(head.data(), 1, head.size(), f) == head.size() &&
+              std::fwrite(payload, 1, bytes, f) == bytes;
+    ok = (std::fclose(f) == 0) && ok;
+    if (!ok) { std::remove(tmp_path.c_str()); return false; }
+    return replace_file(tmp_path, path);
+}
+
+// Map a table file and validate it against the expected header.
+// Returns false (and leaves 'buf' empty) on any mismatch or corruption.
+bool load_table(const std::string &path, const TableHeader &expected, TableBuffer &buf) {
+    if (force_regen || !buf.map_file(path, TABLE_PAYLOAD_OFFSET)) return false;
+    
+    TableHeader h;
+    std::memcpy(&h, buf.mapped_base(), sizeof(h));
+    bool ok = std::memcmp(h.magic, TABLE_MAGIC, sizeof(TABLE_MAGIC)) == 0 &&
+              h.version == expected.version &&
+              h.elem_bits == expected.elem_bits &&
+              h.elem_count == expected.elem_count &&
+              std::memcmp(h.dims, expected.dims, sizeof(h.dims)) == 0 &&
+              std::memcmp(h.start, expected.start, sizeof(h.start)) == 0 &&
+              h.d_offsets == expected.d_offsets &&
+              buf.size() == (h.elem_count * h.elem_bits + 7) / 8;
+    if (ok) ok = table_checksum(buf.data(), buf.size()) == h.checksum;
+    
+    if (!ok) {
+        std::cout << " [" << path << " invalid, regenerating]" << std::flush;
+        buf.release();
+    }
+    return ok;
+}
+
+// Pruning table with two 4-bit depths packed per byte (entry i lives in byte i/2,
+// low nibble for even i). NIBBLE_EMPTY marks unvisited states, so depths 0..14 fit.
+const unsigned char NIBBLE_EMPTY = 0xF;
+
+class NibbleTable {
+public:
+    // Allocate 'n' entries, all unvisited
+    void allocate(long long n) {
+        entries = n;
+        buf.allocate((size_t)((n + 1) / 2), 0xFF);
+    }
+
+    // Map a cached table (see load_table); 'header' must describe 4-bit entries. With an
+    // interleave policy or huge pages the mapping is copied into placed memory, since page
+    // cache pages cannot be moved or backed by huge pages.
+    bool load(const std::string &path, const TableHeader &header) {
+        if (!load_table(path, header, buf)) return false;
+        entries = (long long)header.elem_count;
+        if (numa_policy == NumaPolicy::Interleave || huge_pages != HugePages::Off) buf.make_resident();
+        return true;
+    }
+
+    // One node-local copy per NUMA node; lookups then read the copy of the calling thread
+    void replicate() {
+        n_replicas = std::min(numa_node_count(), max_replicas);
+        if (n_replicas <= 1) { n_replicas = 0; return; }
+        for (int n = 0; n < n_replicas; ++n) replicas[n].copy_from(buf, n);
+    }
+
+    bool save(const std::string &path, const TableHeader &header) const {
+        return save_table(path, header, buf.data(), buf.size());
+    }
+
+    inline unsigned char get(long long i) const {
+        return (local_data()[i >> 1] >> ((i & 1) << 2)) & 0xF;
+    }
+
+    // Plain (non-atomic) store, for callers that own the containing byte exclusively
+    inline void set(long long i, unsigned char depth) {
+        unsigned char* w = buf.mutable_data();
+        int shift = (i & 1) << 2;
+        w[i >> 1] = (unsigned char)((w[i >> 1] & ~(0xF << shift)) | (depth << shift));
+    }
+
+    // Decode 'count' consecutive entries starting at an even index into 'out'
+    inline void decode_block(long long first, int count, unsigned char* out) const {
+        const unsigned char* p = local_data() + (first >> 1);
+        for (int k = 0; k < count / 2; ++k) {
+            out[2 * k] = p[k] & 0xF;
+            out[2 * k + 1] = p[k] >> 4;
+        }
+    }
+
+    long long size() const { return entries; }
+
+    void release() {
+        buf.release();
+        for (int n = 0; n < n_replicas; ++n) replicas[n].release();
+        n_replicas = 0;
+        entries = 0;
+    }
+
+private:
+    static const int max_replicas = 8;
+    long long entries = 0;
+    TableBuffer buf;
+    TableBuffer replicas[max_replicas];
+    int n_replicas = 0;
+
+    inline const unsigned char* local_data() const {
+        return n_replicas > 1 ? replicas[std::min(current_numa_node(), n_replicas - 1)].data() : buf.data();
+    }
+};
+
+// Load a move table from disk, or generate and cache it
+template <typename Generator>
+std::vector<int> load_or_create_move_table(const std::string &file_name, const TableHeader &header, Generator gen) {
+    std::string path = table_path(file_name);
+    TableBuffer buf;
+    if (load_table(path, header, buf)) {
+        const int* p = reinterpret_cast<const int*>(buf.data());
+        return std::vector<int>(p, p + header.elem_count);
+    }
+    std::vector<int> mt = gen();
+    if (!save_table(path, header, mt.data(), mt.size() * sizeof(int))) {
+        std::cout << " [Warning: could not write " << path << "]" << std::flush;
+    }
+    return mt;
+}
+
+// =========================================================================================
+// PART 3: Fixed Distance Table (Dual: BL and BR)
 // =========================================================================================
 
-// Global Pruning Tables
-std::vector<unsigned char> table_bl;
-std::vector<unsigned char> table_br;
+// Global Pruning Tables (4-bit packed, heap-generated or memory-mapped from disk)
+NibbleTable table_bl;
+NibbleTable table_br;
+// Pseudo variants only: corner of slot k with the edge of slot q (BL, BR) for k != q; the
+// same-slot pairs are table_bl / table_br
+NibbleTable table_mixed[4][2];
 
 // Constants defining the size of the coordinate space
 const long long sz_cr = 190080; // Size of Cross permutation coordinate
 const long long sz_cn = 24;     // Size of Corner coordinate
 const long long sz_ed = 24;     // Size of Edge coordinate
+const int sz_block = sz_cn * sz_ed; // Entries per cross index (one contiguous block)
+
+const int move_d = 3; // "D" in move_names, generator of the pseudo (D-layer offset) goals
+
+// Direction-switch threshold: expand bottom-up once the frontier exceeds 1/bfs_alpha of the unvisited states
+const long long bfs_alpha = 64;
+
+// One bitset row holds every edge state for a fixed (cross, corner) pair
+typedef uint32_t BfsRow;
 
-// BFS to generate pruning table (distance to solved state)
-void generate_table(std::vector<unsigned char> &table, int idx_cr, int idx_cn, int idx_ed, 
-    const std::vector<int> &t1, const std::vector<int> &t2, const std::vector<int> &t3, const std::string &name) 
+// BFS to generate pruning table (distance to solved state).
+// Keeps explicit frontier/visited bitsets instead of rescanning the table at every depth.
+// Each (cross, corner) row of sz_ed bits maps, under a fixed move, onto a single target row
+// with its columns permuted, so neighbours are produced a whole row at a time through a
+// byte-wise permutation lookup. Small frontiers are expanded top-down (atomic OR on the
+// target rows); large ones switch to bottom-up, where each block of unvisited states pulls
+// from the frontier and every block is written by exactly one thread. The depth nibbles of
+// a level are written afterwards from the 'next' bitset, again one block per thread, so the
+// result and the per-level counts are fully deterministic.
+// With n_offsets > 1 the BFS starts from the start state and its D, D2, D' images (pseudo variants).
+void generate_table(NibbleTable &table, int idx_cr, int idx_cn, int idx_ed, 
+    const std::vector<int> &t1, const std::vector<int> &t2, const std::vector<int> &t3, const std::string &name, 
+    int n_offsets = 1) 
 {
+    static_assert(sz_ed <= 8 * (long long)sizeof(BfsRow) && sz_ed <= 24, "edge coordinate must fit in one row");
+    const BfsRow full_row = (BfsRow)((1ULL << sz_ed) - 1);
+    const int inv[18] = {2, 1, 0, 5, 4, 3, 8, 7, 6, 11, 10, 9, 14, 13, 12, 17, 16, 15};
     long long total = sz_cr * sz_cn * sz_ed;
+    long long rows = sz_cr * sz_cn;
     std::cout << "[Step 2] Allocating " << name << "..." << std::flush;
     
     // Internal Timer for BFS
     auto t_start = std::chrono::high_resolution_clock::now();
     
-    table.resize(total, 255); // Initialize with max value (unvisited)
+    table.allocate(total); // Initialize with NIBBLE_EMPTY (unvisited)
+    std::vector<BfsRow> frontier(rows, 0), next(rows, 0), visited(rows, 0);
+    
+    // col_lut[j]: row of neighbour columns, bit e = source bit t3[e][j] (three byte lookups)
+    std::vector<BfsRow> col_lut(18 * 3 * 256, 0);
+    for(int j = 0; j < 18; ++j) {
+        for(int e = 0; e < sz_ed; ++e) {
+            int s = t3[e * 18 + j];
+            for(int v = 0; v < 256; ++v) {
+                if((v >> (s & 7)) & 1) col_lut[(j * 3 + (s >> 3)) * 256 + v] |= (BfsRow)1 << e;
+            }
+        }
+    }
+    auto pull_cols = [&](int j, BfsRow x) -> BfsRow {
+        const BfsRow* L = &col_lut[j * 3 * 256];
+        return L[x & 255] | L[256 + ((x >> 8) & 255)] | L[512 + ((x >> 16) & 255)];
+    };
     
-    long long start_idx = ((long long)idx_cr * sz_cn + idx_cn) * sz_ed + idx_ed;
-    table[start_idx] = 0; // Base case: distance 0
+    int s_cr = idx_cr, s_cn = idx_cn, s_ed = idx_ed;
+    for(int d = 0; d < n_offsets; ++d) {
+        long long start_row = (long long)s_cr * sz_cn + s_cn;
+        frontier[start_row] |= (BfsRow)1 << s_ed;
+        visited[start_row] |= (BfsRow)1 << s_ed;
+        table.set(start_row * sz_ed + s_ed, 0); // Base case: distance 0
+        s_cr = t1[s_cr * 24 + move_d] / 24;
+        s_cn = t2[s_cn * 18 + move_d];
+        s_ed = t3[s_ed * 18 + move_d];
+    }
     
+    long long frontier_count = n_offsets;
+    long long unvisited = total - n_offsets;
     int depth = 0;
     
     while(true) {
         long long count = 0;
+        bool bottom_up = frontier_count * bfs_alpha > unvisited;
         
-        // Parallelized BFS expansion
-        #pragma omp parallel for reduction(+:count)
-        for(long long i = 0; i < total; ++i) {
-            if(table[i] == depth) {
-                // Decode combined index into separate coordinates
-                int cur_ed = i % sz_ed;
-                long long tmp = i / sz_ed;
-                int cur_cn = tmp % sz_cn;
-                int cur_cr = tmp / sz_cn;
-                
-                int t1_idx = cur_cr * 24;
-                int t2_idx = cur_cn * 18;
-                int t3_idx = cur_ed * 18;
+        #pragma omp parallel for
+        for(long long r = 0; r < rows; ++r) next[r] = 0;
+        
+        if(!bottom_up) {
+            // Top-down: push every frontier row through all 18 moves
+            #pragma omp parallel for schedule(dynamic, 64) reduction(+:count)
+            for(long long cr = 0; cr < sz_cr; ++cr) {
+                const BfsRow* fb = &frontier[cr * sz_cn];
+                BfsRow any = 0;
+                for(int cn = 0; cn < sz_cn; ++cn) any |= fb[cn];
+                if(!any) continue;
                 
-                // Try all 18 moves
                 for(int j = 0; j < 18; ++j) {
-                    long long n_cr = t1[t1_idx + j] / 24;
-                    int n_cn = t2[t2_idx + j];
-                    int n_ed = t3[t3_idx + j];
-                    long long ni = (n_cr * sz_cn + n_cn) * sz_ed + n_ed;
+                    long long n_base = (long long)(t1[cr * 24 + j] / 24) * sz_cn;
+                    for(int cn = 0; cn < sz_cn; ++cn) {
+                        if(!fb[cn]) continue;
+                        // Pushing through j is pulling through its inverse
+                        BfsRow bits = pull_cols(inv[j], fb[cn]);
+                        long long tr = n_base + t2[cn * 18 + j];
+                        if(!(bits & ~__atomic_load_n(&visited[tr], __ATOMIC_RELAXED))) continue;
+                        // Claim the states; only the first claimant records them
+                        BfsRow fresh = bits & ~__atomic_fetch_or(&visited[tr], bits, __ATOMIC_RELAXED);
+                        if(fresh) {
+                            __atomic_fetch_or(&next[tr], fresh, __ATOMIC_RELAXED);
+                            count += __builtin_popcount(fresh);
+                        }
+                    }
+                }
+            }
+        } else {
+            // Bottom-up: each unvisited state checks whether one move reaches the frontier
+            // (the move set is closed under inverses). Block 'cr' is owned by one thread.
+            #pragma omp parallel for schedule(dynamic, 64) reduction(+:count)
+            for(long long cr = 0; cr < sz_cr; ++cr) {
+                BfsRow todo[sz_cn], found[sz_cn];
+                BfsRow any = 0;
+                for(int cn = 0; cn < sz_cn; ++cn) {
+                    todo[cn] = ~visited[cr * sz_cn + cn] & full_row;
+                    found[cn] = 0;
+                    any |= todo[cn];
+                }
+                
+                for(int j = 0; j < 18 && any; ++j) {
+                    const BfsRow* fb = &frontier[(long long)(t1[cr * 24 + j] / 24) * sz_cn];
+                    BfsRow f_any = 0;
+                    for(int cn = 0; cn < sz_cn; ++cn) f_any |= fb[cn];
+                    if(!f_any) continue;
                     
-                    if(table[ni] == 255) {
-                        table[ni] = depth + 1;
-                        count++;
+                    any = 0;
+                    for(int cn = 0; cn < sz_cn; ++cn) {
+                        if(!todo[cn]) continue;
+                        found[cn] |= pull_cols(j, fb[t2[cn * 18 + j]]) & todo[cn];
+                        todo[cn] &= ~found[cn];
+                        any |= todo[cn];
                     }
                 }
+                
+                for(int cn = 0; cn < sz_cn; ++cn) {
+                    visited[cr * sz_cn + cn] |= found[cn];
+                    next[cr * sz_cn + cn] = found[cn];
+                    count += __builtin_popcount(found[cn]);
+                }
             }
         }
+        
         if(count == 0) break; // BFS complete
+        
+        // Record the new level in the table; each cross block's bytes belong to one thread
+        #pragma omp parallel for schedule(dynamic, 256)
+        for(long long cr = 0; cr < sz_cr; ++cr) {
+            for(int cn = 0; cn < sz_cn; ++cn) {
+                long long r = cr * sz_cn + cn;
+                BfsRow bits = next[r];
+                while(bits) {
+                    table.set(r * sz_ed + __builtin_ctz(bits), depth + 1);
+                    bits &= bits - 1;
+                }
+            }
+        }
+        
+        frontier.swap(next);
+        frontier_count = count;
+        unvisited -= count;
         depth++;
     }
     
@@ -296,8 +915,77 @@ void generate_table(std::vector<unsigned char> &table, int idx_cr, int idx_cn, i
     std::cout << " Done. (Max Depth: " << depth << ", Time: " << std::fixed << std::setprecision(2) << t_el.count() << "s)" << std::endl;
 }
 
+// Map the pruning table from disk if a valid cached copy exists, otherwise run the BFS and cache it
+void load_or_generate_table(NibbleTable &table, int idx_cr, int idx_cn, int idx_ed, 
+    const std::vector<int> &t1, const std::vector<int> &t2, const std::vector<int> &t3, 
+    const std::string &name, const std::string &file_name, int n_offsets = 1) 
+{
+    std::string path = table_path(file_name);
+    TableHeader header = make_table_header(4, sz_cr * sz_cn * sz_ed, sz_cr, sz_cn, sz_ed, idx_cr, idx_cn, idx_ed);
+    if (n_offsets > 1) header.d_offsets = n_offsets;
+    
+    std::cout << "[Step 2] Loading " << name << " from " << path << "..." << std::flush;
+    auto t_start = std::chrono::high_resolution_clock::now();
+    if (table.load(path, header)) {
+        std::chrono::duration<double> t_el = std::chrono::high_resolution_clock::now() - t_start;
+        std::cout << " Done. (Mapped, Time: " << std::fixed << std::setprecision(2) << t_el.count() << "s)" << std::endl;
+        if (numa_policy == NumaPolicy::Replicate) table.replicate();
+        return;
+    }
+    std::cout << " Not cached." << std::endl;
+    
+    generate_table(table, idx_cr, idx_cn, idx_ed, t1, t2, t3, name, n_offsets);
+    if (!table.save(path, header)) {
+        std::cout << "[Warning] Could not write " << path << std::endl;
+    }
+    if (numa_policy == NumaPolicy::Replicate) table.replicate();
+}
+
+// Interleaved BL/BR layout for the aggregation loop: byte i holds the BL depth of entry i in
+// the low nibble and the BR depth in the high nibble, so both slots' 576 entries of one cross
+// state form a single contiguous, cache-line aligned block (9 lines) instead of two nibble
+// blocks that straddle line boundaries.
+class PairTable {
+public:
+    void build(const NibbleTable &bl, const NibbleTable &br) {
+        buf.allocate((size_t)bl.size(), 0);
+        unsigned char* out = buf.mutable_data();
+        #pragma omp parallel for schedule(static)
+        for (int cr = 0; cr < sz_cr; ++cr) {
+            unsigned char lo[sz_block], hi[sz_block];
+            bl.decode_block((long long)cr * sz_block, sz_block, lo);
+            br.decode_block((long long)cr * sz_block, sz_block, hi);
+            unsigned char* dst = out + (long long)cr * sz_block;
+            for (int i = 0; i < sz_block; ++i) dst[i] = (unsigned char)(lo[i] | (hi[i] << 4));
+        }
+        if (numa_policy == NumaPolicy::Replicate) {
+            n_replicas = std::min(numa_node_count(), max_replicas);
+            if (n_replicas <= 1) n_replicas = 0;
+            for (int n = 0; n < n_replicas; ++n) replicas[n].copy_from(buf, n);
+        }
+    }
+
+    inline const unsigned char* block(int cr) const {
+        const unsigned char* base = n_replicas > 1 ? replicas[std::min(current_numa_node(), n_replicas - 1)].data() : buf.data();
+        return base + (long long)cr * sz_block;
+    }
+
+    inline void prefetch(int cr) const {
+        const unsigned char* p = block(cr);
+        for (int off = 0; off < sz_block; off += 64) __builtin_prefetch(p + off);
+    }
+
+private:
+    static const int max_replicas = 8;
+    TableBuffer buf;
+    TableBuffer replicas[max_replicas];
+    int n_replicas = 0;
+};
+
+PairTable table_pair;
+
 // =========================================================================================
-// PART 3: Symmetry & Combinatorics (Optimized)
+// PART 4: Symmetry & Combinatorics (Optimized)
 // =========================================================================================
 
 // Symmetry mapping constants (y2 rotation)
@@ -305,18 +993,38 @@ const int y2_corn[8] = {2, 3, 0, 1, 6, 7, 4, 5};
 const int y2_edge[12] = {2, 3, 0, 1, 6, 7, 4, 5, 10, 11, 8, 9};
 
 std::vector<int> cross_y2_map;
-std::vector<int> masks_2bits; 
-std::vector<std::pair<int, int>> disjoint_pairs; 
+// Number of k thresholds accumulated by the aggregator (k = 0 .. n_depth - 1)
+const int n_depth = 12;
+
+constexpr int binomial(int n, int k) { return (k < 0 || k > n) ? 0 : (k == 0 ? 1 : binomial(n - 1, k - 1) * n / k); }
+constexpr int subset_count(int max_bits) { return max_bits < 0 ? 0 : binomial(8, max_bits) + subset_count(max_bits - 1); }
+
+// All masks with 'Bits' set bits over the 8 free corner / edge positions, with their bit indices
+template<int Bits>
+struct MaskSet {
+    static constexpr int count = binomial(8, Bits);
+    int mask[count];
+    int bits[count][Bits > 0 ? Bits : 1];
+
+    MaskSet() {
+        int n = 0;
+        for(int m = 0; m < 256; ++m) {
+            if(__builtin_popcount(m) != Bits) continue;
+            int b = 0;
+            for(int i = 0; i < 8; ++i) if((m >> i) & 1) bits[n][b++] = i;
+            mask[n++] = m;
+        }
+    }
+};
 
 // Precompute the effect of y2 rotation on cross coordinates
 void precompute_cross_y2() {
     cross_y2_map.resize(sz_cr);
-    std::vector<int> p(4), p_transformed(4);
+    int p[4], p_transformed[4];
     for (int i = 0; i < sz_cr; ++i) {
         index_to_array(p, i, 4, 2, 12);
-        std::vector<int> p_perm(4);
         // Permute pieces based on y2 symmetry
-        p_perm[0] = p[2]; p_perm[1] = p[3]; p_perm[2] = p[0]; p_perm[3] = p[1];
+        int p_perm[4] = {p[2], p[3], p[0], p[1]};
         
         for(int k = 0; k < 4; ++k) {
             int val = p_perm[k] / 18;
@@ -324,227 +1032,2836 @@ void precompute_cross_y2() {
             int ori = val % 2;
             int new_p = y2_edge[pos]; // Map position
             int new_o = ori;          // Orientation is invariant under y2 for edges in this context
-            p_transformed[k] = 18 * (2 * new_p + new_o);
+            p_transformed[k] = 2 * new_p + new_o;
         }
-        std::vector<int> p_unscaled(4);
-        for(int k = 0; k < 4; ++k) p_unscaled[k] = p_transformed[k] / 18;
-        cross_y2_map[i] = array_to_index(p_unscaled, 4, 2, 12);
+        cross_y2_map[i] = array_to_index(p_transformed, 4, 2, 12);
+    }
+}
+
+// D-axis symmetries acting on the cross coordinate: y^i (i = 0..3), each optionally followed
+// by the left-right mirror. Every symmetry S fixes the solved cross and maps the four F2L
+// slots onto each other, so conjugating a state by S preserves the minimum xcross distance
+// over all slots. The aggregation result of a cross state therefore only depends on its orbit.
+const int n_sym = 8;
+const int y_face[6] = {0, 1, 5, 4, 2, 3};       // y: F -> L -> B -> R -> F (faces U, D, L, R, F, B)
+const int mirror_face[6] = {0, 1, 3, 2, 4, 5};  // Mirror: L <-> R, turn directions inverted
+const int slot_faces[4][2] = {{5, 2}, {5, 3}, {4, 3}, {4, 2}}; // BL, BR, FR, FL
+
+std::vector<int> cross_sym_map[n_sym];
+std::vector<int> cross_tasks;         // Cross coordinates visited by the search loop
+std::vector<long long> cross_weights; // Number of cross states each task stands for
+int cross_group = 1;                  // Symmetries (bit g) the tasks were reduced by
+std::vector<unsigned char> cross_task_mirrors; // Task t is the y2 image of task t - 1
+// Distance of each cross coordinate to the solved cross (any accepted D-layer offset)
+std::vector<unsigned char> table_cross;
+
+// Image of face 'face' under symmetry 'g'
+int sym_face(int g, int face) {
+    for(int i = 0; i < g % 4; ++i) face = y_face[face];
+    return g >= 4 ? mirror_face[face] : face;
+}
+
+// Image of move 'm' under symmetry 'g' (S m S^-1)
+int sym_move(int g, int m) {
+    int pow = m % 3;
+    if(g >= 4) pow = 2 - pow;
+    return 3 * sym_face(g, m / 3) + pow;
+}
+
+// Slot that symmetry 'g' maps slot 's' onto
+int slot_image(int g, int s) {
+    int f0 = sym_face(g, slot_faces[s][0]), f1 = sym_face(g, slot_faces[s][1]);
+    for(int t = 0; t < 4; ++t) {
+        if((slot_faces[t][0] == f0 && slot_faces[t][1] == f1) || (slot_faces[t][0] == f1 && slot_faces[t][1] == f0)) return t;
     }
+    return -1;
 }
 
-// Initialize bitmasks for disjoint subsets used in the Meet-in-the-Middle step
-void init_masks_opt() {
-    masks_2bits.clear();
-    for(int i = 0; i < 256; ++i) {
-        if(__builtin_popcount(i) == 2) masks_2bits.push_back(i);
+// Set of symmetries (bit g) that map the given set of slots (bit s) onto itself
+int slot_stabilizer(int slot_mask) {
+    int group = 0;
+    for(int g = 0; g < n_sym; ++g) {
+        int image = 0;
+        for(int s = 0; s < 4; ++s) {
+            if((slot_mask >> s) & 1) image |= 1 << slot_image(g, s);
+        }
+        if(image == slot_mask) group |= 1 << g;
     }
-    // Precompute disjoint pairs indices to avoid branching in the inner loop
-    disjoint_pairs.clear();
-    for(int i = 0; i < masks_2bits.size(); ++i) {
-        for(int j = 0; j < masks_2bits.size(); ++j) {
-            // If masks share no bits, they represent disjoint sets of pieces
-            if((masks_2bits[i] & masks_2bits[j]) == 0) {
-                disjoint_pairs.push_back({i, j});
+    return group;
+}
+
+// Build cross_sym_map by walking the move graph from the solved cross: if x reaches cr through
+// a move sequence, S x S^-1 reaches the image of cr through the conjugated sequence
+void precompute_cross_symmetry(const std::vector<int> &mt_multi) {
+    for(int g = 0; g < n_sym; ++g) {
+        std::vector<int> &map = cross_sym_map[g];
+        map.assign(sz_cr, -1);
+        std::vector<int> queue;
+        queue.reserve(sz_cr);
+        map[187520] = 187520;
+        queue.push_back(187520);
+        for(size_t q = 0; q < queue.size(); ++q) {
+            int cr = queue[q];
+            for(int m = 0; m < 18; ++m) {
+                int n_cr = mt_multi[cr * 24 + m] / 24;
+                if(map[n_cr] == -1) {
+                    map[n_cr] = mt_multi[map[cr] * 24 + sym_move(g, m)] / 24;
+                    queue.push_back(n_cr);
+                }
+            }
+        }
+        // The map must commute with every move, otherwise the symmetry is not well defined
+        for(int cr = 0; cr < sz_cr; ++cr) {
+            for(int m = 0; m < 18; ++m) {
+                if(map[mt_multi[cr * 24 + m] / 24] != mt_multi[map[cr] * 24 + sym_move(g, m)] / 24) {
+                    std::cerr << "[Error] Symmetry " << g << " is inconsistent on the cross coordinate" << std::endl;
+                    std::exit(1);
+                }
             }
         }
     }
-    std::cout << "[Init] Masks: " << masks_2bits.size() << ", Disjoint Pairs: " << disjoint_pairs.size() << std::endl;
 }
 
-// Helper to extract bit indices from a mask
-inline void get_mask_indices(int mask, int &i1, int &i2) {
-    i1 = -1; 
-    for(int i = 0; i < 8; ++i) {
-        if((mask >> i) & 1) {
-            if(i1 == -1) i1 = i; else { i2 = i; break; }
+// Fill the task list of the search loop: one representative (smallest coordinate) per class
+// of the symmetries in 'group' (bit g), weighted by the class size. Only representatives in
+// [cr_begin, cr_end) are kept, so shards over disjoint ranges split the classes between them.
+void init_cross_tasks(int group, int cr_begin, int cr_end) {
+    cross_group = group;
+    cross_tasks.clear();
+    cross_weights.clear();
+    for(int cr = cr_begin; cr < cr_end; ++cr) {
+        int images[n_sym], n_images = 0;
+        bool is_rep = true;
+        for(int g = 0; g < n_sym && is_rep; ++g) {
+            if(!((group >> g) & 1)) continue;
+            int image = cross_sym_map[g][cr];
+            if(image < cr) is_rep = false;
+            // Count distinct images only
+            bool seen = false;
+            for(int i = 0; i < n_images; ++i) seen = seen || images[i] == image;
+            if(!seen) images[n_images++] = image;
         }
+        if(!is_rep) continue;
+        cross_tasks.push_back(cr);
+        cross_weights.push_back(n_images);
+    }
+    cross_task_mirrors.assign(cross_tasks.size(), 0);
+    long long covered = 0;
+    for(long long w : cross_weights) covered += w;
+    std::cout << "[Init] Cross Tasks: " << cross_tasks.size() << " (covering " << covered << " states)" << std::endl;
+}
+
+// Iteration schedules of the search loop. Each task reads the table blocks at cr and at its
+// y2 image, which lands far from cr in index order.
+//   plain:  index order
+//   paired: cr directly followed by its y2 image when that is a task too, pairs ordered by the
+//           smaller coordinate; the second task of a pair relabels the first one's histograms
+//   tiled:  tasks grouped by the 64-coordinate tiles of cr and of its y2 image, so neighbouring
+//           tasks share blocks whether or not the y2 image is a task itself; pairs stay adjacent
+enum class TaskSchedule { Plain, Paired, Tiled };
+const char* schedule_names[] = {"plain", "paired", "tiled"};
+const int schedule_tile = 64;
+
+void schedule_cross_tasks(TaskSchedule schedule) {
+    size_t n = cross_tasks.size();
+    cross_task_mirrors.assign(n, 0);
+    if(schedule == TaskSchedule::Plain) return;
+    std::vector<std::pair<long long, size_t>> keys(n);
+    for(size_t t = 0; t < n; ++t) {
+        int cr = cross_tasks[t], lo = std::min(cr, cross_y2_map[cr]), hi = std::max(cr, cross_y2_map[cr]);
+        long long key = 2LL * lo + (cr != lo);
+        if(schedule == TaskSchedule::Tiled) key += 2LL * sz_cr * (hi / schedule_tile + (long long)(sz_cr / schedule_tile + 1) * (lo / schedule_tile));
+        keys[t] = {key, t};
+    }
+    std::sort(keys.begin(), keys.end());
+    std::vector<int> tasks(n);
+    std::vector<long long> weights(n);
+    for(size_t t = 0; t < n; ++t) {
+        tasks[t] = cross_tasks[keys[t].second];
+        weights[t] = cross_weights[keys[t].second];
+        cross_task_mirrors[t] = t > 0 && tasks[t] != tasks[t - 1] && tasks[t] == cross_y2_map[tasks[t - 1]];
     }
+    cross_tasks.swap(tasks);
+    cross_weights.swap(weights);
 }
 
 // =========================================================================================
-// MAIN
+// Search Loop Instrumentation (compiled in with -DXCROSS_INSTRUMENT)
 // =========================================================================================
+// Per-thread busy time, iterations and scheduler chunks for each aggregation step, plus
+// Linux perf_event_open counters (cycles, instructions, cache misses) read at every step
+// boundary when the kernel allows it. Without XCROSS_INSTRUMENT the hooks expand to nothing.
+#ifdef XCROSS_INSTRUMENT
+const int n_prof_phases = 3;
+const char* prof_phase_names[n_prof_phases] = {"histogram", "mitm_tables", "join"};
+const int n_prof_events = 3;
+const char* prof_event_names[n_prof_events] = {"cycles", "instructions", "cache_misses"};
 
-int main() {
-    auto global_start = std::chrono::high_resolution_clock::now();
+struct alignas(64) ThreadProfile {
+    double busy[n_prof_phases] = {0};
+    long long iterations = 0, chunks = 0, last_task = -2;
+    unsigned long long events[n_prof_phases][n_prof_events] = {{0}};
+    unsigned long long mark_events[n_prof_events] = {0};
+    std::chrono::steady_clock::time_point mark;
+    int perf_fds[n_prof_events] = {-1, -1, -1}; // Counter group, the leader first
+    bool perf_tried = false;
+};
+std::vector<ThreadProfile> thread_profiles;
 
-    std::cout << "[Init] Generating Move Tables..." << std::flush;
-    TICK(init);
-    auto mt_edge = create_edge_move_table();
-    auto mt_corn = create_corner_move_table();
-    auto mt_multi = create_multi_move_table(4, 2, 12, sz_cr, mt_edge);
-    TOCK(init);
-    
-    // Generate pruning tables for Left and Right sides
-    generate_table(table_bl, 187520, 12, 0, mt_multi, mt_corn, mt_edge, "BL Table");
-    generate_table(table_br, 187520, 15, 2, mt_multi, mt_corn, mt_edge, "BR Table");
-    
-    TICK(precomp);
-    precompute_cross_y2();
-    init_masks_opt();
-    TOCK(precomp);
-    
-    std::cout << "[Step 4] Aggregating Non-Fixed Distribution (High Performance Mode)..." << std::endl;
-    long long total_counts[20] = {0};
-    
-    TICK(search);
-    
-    // Main Parallel Loop over Cross States
-    #pragma omp parallel
-    {
-        std::vector<long long> local_counts(20, 0);
-        std::vector<int> free_corners(8), free_edges(8), p_cross(4);
-        int dist_hist[4][8][8][14];
-        int valid_ge_k[4][8][8][14]; // Histogram accumulation: [symmetry][c_idx][e_idx][min_dist]
-        
-        // Intermediate tables for Meet-in-the-Middle
-        long long t_left[28][28][12];
-        long long t_right[28][28][12];
+#ifdef __linux__
+// Open the three counters as one group on the calling thread
+void perf_open(ThreadProfile &tp) {
+    tp.perf_tried = true;
+    const unsigned long long configs[n_prof_events] = {PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_CACHE_MISSES};
+    int fds[n_prof_events], leader = -1;
+    for (int e = 0; e < n_prof_events; ++e) {
+        perf_event_attr attr;
+        std::memset(&attr, 0, sizeof(attr));
+        attr.size = sizeof(attr);
+        attr.type = PERF_TYPE_HARDWARE;
+        attr.config = configs[e];
+        attr.disabled = (e == 0);
+        attr.exclude_kernel = 1;
+        attr.exclude_hv = 1;
+        attr.read_format = PERF_FORMAT_GROUP;
+        fds[e] = (int)syscall(SYS_perf_event_open, &attr, 0, -1, leader, 0);
+        if (fds[e] < 0) {
+            for (int i = 0; i < e; ++i) close(fds[i]);
+            return;
+        }
+        if (e == 0) leader = fds[e];
+    }
+    ioctl(leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    for (int e = 0; e < n_prof_events; ++e) tp.perf_fds[e] = fds[e];
+}
 
-        #pragma omp for schedule(dynamic, 100)
-        for (int cr = 0; cr < sz_cr; ++cr) {
-            index_to_array(p_cross, cr, 4, 2, 12);
-            int mask_edges_used = 0;
-            for(int val : p_cross) mask_edges_used |= (1 << ((val / 18) / 2));
-            
-            // Determine available free pieces
-            int fc = 0, fe = 0;
-            for(int i = 0; i < 8; ++i) free_corners[fc++] = i; 
-            for(int i = 0; i < 12; ++i) if(!((mask_edges_used >> i) & 1)) free_edges[fe++] = i;
-            
-            int cr_rot = cross_y2_map[cr];
-            std::memset(dist_hist, 0, sizeof(dist_hist));
-            
-            // 1. Build Histogram for single pieces relative to Cross
-            int t_bl_idx = cr * sz_cn;
-            int t_br_idx = cr * sz_cn;
-            int t_bl_rot_idx = cr_rot * sz_cn;
-            int t_br_rot_idx = cr_rot * sz_cn;
-
-            for(int u = 0; u < 8; ++u) { 
-                int real_c = free_corners[u];
-                int c_y2 = y2_corn[real_c];
-                int c_idx_01 = (3 * real_c);
-                int c_idx_23 = (3 * c_y2);
-
-                for(int v = 0; v < 8; ++v) { 
-                    int real_e = free_edges[v];
-                    int e_y2 = y2_edge[real_e];
-                    int e_idx_01 = (2 * real_e);
-                    int e_idx_23 = (2 * e_y2);
+void perf_close(ThreadProfile &tp) {
+    for (int e = 0; e < n_prof_events; ++e) {
+        if (tp.perf_fds[e] >= 0) close(tp.perf_fds[e]);
+        tp.perf_fds[e] = -1;
+    }
+}
 
-                    for(int co = 0; co < 3; ++co) {
-                        for(int eo = 0; eo < 2; ++eo) {
-                            // Look up distances in pruning tables
-                            long long idx0 = (long long)(t_bl_idx + c_idx_01 + co) * sz_ed + (e_idx_01 + eo);
-                            int d0 = table_bl[idx0];
-                            if(d0 < 14) dist_hist[0][u][v][d0]++;
-                            
-                            long long idx1 = (long long)(t_br_idx + c_idx_01 + co) * sz_ed + (e_idx_01 + eo);
-                            int d1 = table_br[idx1];
-                            if(d1 < 14) dist_hist[1][u][v][d1]++;
-                            
-                            long long idx2 = (long long)(t_bl_rot_idx + c_idx_23 + co) * sz_ed + (e_idx_23 + eo);
-                            int d2 = table_bl[idx2];
-                            if(d2 < 14) dist_hist[2][u][v][d2]++;
-                            
-                            long long idx3 = (long long)(t_br_rot_idx + c_idx_23 + co) * sz_ed + (e_idx_23 + eo);
-                            int d3 = table_br[idx3];
-                            if(d3 < 14) dist_hist[3][u][v][d3]++;
-                        }
-                    }
-                }
-            }
-            
-            // 2. Compute Cumulative Sums for greater-than-or-equal logic
-            for(int p = 0; p < 4; ++p) {
-                for(int u = 0; u < 8; ++u) {
-                    for(int v = 0; v < 8; ++v) {
-                        int sum = 0;
-                        for(int d = 13; d >= 0; --d) {
-                            sum += dist_hist[p][u][v][d];
-                            valid_ge_k[p][u][v][d] = sum;
-                        }
-                    }
-                }
-            }
+bool perf_read(const ThreadProfile &tp, unsigned long long* values) {
+    unsigned long long buf[1 + n_prof_events];
+    if (read(tp.perf_fds[0], buf, sizeof(buf)) != (ssize_t)sizeof(buf)) return false;
+    for (int e = 0; e < n_prof_events; ++e) values[e] = buf[1 + e];
+    return true;
+}
+#else
+void perf_open(ThreadProfile &tp) { tp.perf_tried = true; }
+void perf_close(ThreadProfile &) {}
+bool perf_read(const ThreadProfile &, unsigned long long*) { return false; }
+#endif
 
-            // 3. Meet-in-the-Middle: Combine subsets of pieces
-            for(int i = 0; i < masks_2bits.size(); ++i) {
-                int mc = masks_2bits[i];
-                int c1, c2; get_mask_indices(mc, c1, c2); 
-                for(int j = 0; j < masks_2bits.size(); ++j) {
-                    int me = masks_2bits[j];
-                    int e1, e2; get_mask_indices(me, e1, e2); 
-                    
-                    for(int k = 0; k < 12; ++k) {
-                         // Combine left side possibilities
-                         long long cnt_l = (long long)valid_ge_k[0][c1][e1][k] * valid_ge_k[1][c2][e2][k];
-                         cnt_l += (long long)valid_ge_k[0][c1][e2][k] * valid_ge_k[1][c2][e1][k];
-                         cnt_l += (long long)valid_ge_k[0][c2][e1][k] * valid_ge_k[1][c1][e2][k];
-                         cnt_l += (long long)valid_ge_k[0][c2][e2][k] * valid_ge_k[1][c1][e1][k];
-                         t_left[i][j][k] = cnt_l;
-
-                         // Combine right side possibilities (symmetric)
-                         long long cnt_r = (long long)valid_ge_k[2][c1][e1][k] * valid_ge_k[3][c2][e2][k];
-                         cnt_r += (long long)valid_ge_k[2][c1][e2][k] * valid_ge_k[3][c2][e1][k];
-                         cnt_r += (long long)valid_ge_k[2][c2][e1][k] * valid_ge_k[3][c1][e2][k];
-                         cnt_r += (long long)valid_ge_k[2][c2][e2][k] * valid_ge_k[3][c1][e1][k];
-                         t_right[i][j][k] = cnt_r;
-                    }
-                }
-            }
+// Close the counters of every thread; each region reopens them on first use
+void profile_release() {
+    for (auto &tp : thread_profiles) perf_close(tp);
+    thread_profiles.clear();
+}
 
-            // 4. Join Step (Vectorized over K using precomputed disjoint pairs)
-            for(const auto& pc : disjoint_pairs) {
-                int mc1_idx = pc.first;
-                int mc2_idx = pc.second;
-                
-                for(const auto& pe : disjoint_pairs) {
-                    int me1_idx = pe.first;
-                    int me2_idx = pe.second;
-                    
-                    // Unroll this inner loop for SIMD auto-vectorization
-                    for(int k = 0; k < 12; ++k) {
-                        local_counts[k] += t_left[mc1_idx][me1_idx][k] * t_right[mc2_idx][me2_idx][k];
-                    }
-                }
-            }
+void profile_reset() {
+    profile_release();
+    thread_profiles.assign(omp_get_max_threads(), ThreadProfile());
+}
+
+// Start of one cross task; a task that does not follow the previous one starts a new chunk
+inline void profile_task(long long task) {
+    ThreadProfile &tp = thread_profiles[omp_get_thread_num()];
+    if (!tp.perf_tried) perf_open(tp);
+    tp.iterations++;
+    if (task != tp.last_task + 1) tp.chunks++;
+    tp.last_task = task;
+    tp.mark = std::chrono::steady_clock::now();
+    if (tp.perf_fds[0] >= 0) perf_read(tp, tp.mark_events);
+}
+
+// End of step 'phase' of the current task
+inline void profile_phase(int phase) {
+    ThreadProfile &tp = thread_profiles[omp_get_thread_num()];
+    auto now = std::chrono::steady_clock::now();
+    tp.busy[phase] += std::chrono::duration<double>(now - tp.mark).count();
+    tp.mark = now;
+    unsigned long long values[n_prof_events];
+    if (tp.perf_fds[0] >= 0 && perf_read(tp, values)) {
+        for (int e = 0; e < n_prof_events; ++e) {
+            tp.events[phase][e] += values[e] - tp.mark_events[e];
+            tp.mark_events[e] = values[e];
         }
-        
-        #pragma omp critical
+    }
+}
+
+void profile_report(double wall_seconds) {
+    std::cout << "\n=== Instrumentation ===" << std::endl;
+    std::cout << std::fixed << std::setprecision(3);
+    double max_busy = 0, sum_busy = 0;
+    int active = 0;
+    for (size_t t = 0; t < thread_profiles.size(); ++t) {
+        const ThreadProfile &tp = thread_profiles[t];
+        double busy = tp.busy[0] + tp.busy[1] + tp.busy[2];
+        std::cout << "[Thread " << t << "] iterations " << tp.iterations << ", chunks " << tp.chunks << ", busy " << busy << "s (";
+        for (int p = 0; p < n_prof_phases; ++p) std::cout << (p ? ", " : "") << prof_phase_names[p] << " " << tp.busy[p] << "s";
+        std::cout << "), idle " << std::max(0.0, wall_seconds - busy) << "s" << std::endl;
+        if (tp.iterations == 0) continue;
+        max_busy = std::max(max_busy, busy);
+        sum_busy += busy;
+        active++;
+    }
+    if (active > 0) {
+        std::cout << "[Balance] max/mean busy: " << std::setprecision(3) << max_busy / (sum_busy / active) << std::endl;
+    }
+    
+    bool have_counters = false;
+    for (const auto &tp : thread_profiles) have_counters = have_counters || tp.perf_fds[0] >= 0;
+    if (!have_counters) {
+        std::cout << "[Counters] perf_event_open unavailable (check /proc/sys/kernel/perf_event_paranoid)" << std::endl;
+        return;
+    }
+    long long iterations = 0;
+    for (const auto &tp : thread_profiles) iterations += tp.iterations;
+    for (int p = 0; p < n_prof_phases; ++p) {
+        unsigned long long ev[n_prof_events] = {0};
+        for (const auto &tp : thread_profiles) for (int e = 0; e < n_prof_events; ++e) ev[e] += tp.events[p][e];
+        std::cout << "[Counters] " << std::left << std::setw(12) << prof_phase_names[p] << std::right;
+        for (int e = 0; e < n_prof_events; ++e) std::cout << " " << prof_event_names[e] << " " << ev[e];
+        std::cout << ", IPC " << std::setprecision(2) << (ev[0] ? (double)ev[1] / ev[0] : 0.0)
+                  << ", misses/iter " << std::setprecision(1) << (iterations ? (double)ev[2] / iterations : 0.0) << std::endl;
+    }
+}
+
+#define PROFILE_TASK(t) profile_task(t)
+#define PROFILE_PHASE(p) profile_phase(p)
+#else
+#define PROFILE_TASK(t)
+#define PROFILE_PHASE(p)
+#endif
+
+// =========================================================================================
+// Meet-in-the-Middle Aggregator
+// =========================================================================================
+// Counts, for one cross state, the placements of the pairs of the tracked slots whose best
+// xcross distance over those slots is >= k. The left side tracks the first LeftSlots of
+// {BL, BR} (pruning tables at cr), the right side the first RightSlots of {FR, FL} (pruning
+// tables at the y2 image of cr). Each side is tabulated per (corner mask, edge mask) of
+// occupied positions, and the two sides are joined over disjoint masks.
+template<int LeftSlots, int RightSlots, int MaxDepth>
+class Aggregator {
+    static_assert(LeftSlots <= 2 && RightSlots <= 2, "each side has two pruning tables");
+public:
+    typedef MaskSet<LeftSlots> LeftMasks;
+    typedef MaskSet<RightSlots> RightMasks;
+    static constexpr int n_left = LeftMasks::count;
+    static constexpr int n_right = RightMasks::count;
+    static constexpr int n_slots = LeftSlots + RightSlots;
+    // Subsets with at most min(LeftSlots, RightSlots) bits, the only ones the join needs
+    static constexpr int sub_bits = LeftSlots < RightSlots ? LeftSlots : RightSlots;
+    static constexpr int n_sub = subset_count(sub_bits);
+    static constexpr int n_sub_left = 1 << LeftSlots;
+    static constexpr int n_sub_right = 1 << RightSlots;
+    // Depth lanes held per (slot, corner position, edge position); MaxDepth may exceed the 14
+    // depths when the lanes are loaded with load_lanes() for the joint histograms
+    static constexpr int n_hist = MaxDepth > 14 ? MaxDepth : 14;
+    typedef int SlotCounts[8][8][n_hist];
+
+    typedef long long LeftTable[n_left][n_left][MaxDepth];   // [corner mask][edge mask][k]
+    typedef long long RightTable[n_right][n_right][MaxDepth];
+
+    Aggregator() {
+        int n = 0;
+        std::vector<int> sub_index(256, -1);
+        for(int m = 0; m < 256; ++m) if(__builtin_popcount(m) <= sub_bits) sub_index[m] = n++;
+        // Subsets of each right mask (summed into sup) and signed subsets of each left mask
+        for(int b = 0; b < n_right; ++b) {
+            for(int s = 0; s < n_sub_right; ++s) {
+                int m = pick_bits(right_masks.bits[b], s);
+                right_sub[b][s] = __builtin_popcount(m) <= sub_bits ? sub_index[m] : n_sub + 1;
+            }
+        }
+        for(int a = 0; a < n_left; ++a) {
+            for(int s = 0; s < n_sub_left; ++s) {
+                int m = pick_bits(left_masks.bits[a], s);
+                left_sub[a][s] = __builtin_popcount(m) <= sub_bits ? sub_index[m] : n_sub;
+            }
+        }
+    }
+
+    // Accumulate the >= k counts of cross state 'cr' into counts[0 .. MaxDepth). 'mirrored':
+    // cr is the y2 image of the previous cross state (see build_histograms_mirrored)
+    void process(int cr, long long* counts, bool verify, bool &mismatch, bool mirrored = false) {
+        if(mirrored) build_histograms_mirrored(cr);
+        else build_histograms(cr);
+        PROFILE_PHASE(0);
+        build_sides();
+        PROFILE_PHASE(1);
+
+        long long join_counts[MaxDepth] = {0};
+        join_disjoint(join_counts);
+        for(int k = 0; k < MaxDepth; ++k) counts[k] += join_counts[k];
+        PROFILE_PHASE(2);
+
+        if(verify) {
+            long long ref_counts[MaxDepth] = {0};
+            join_reference(ref_counts);
+            mismatch = std::memcmp(ref_counts, join_counts, sizeof(ref_counts)) != 0;
+        }
+    }
+
+    // Pull the table blocks of cross state 'cr' into the cache ahead of build_histograms(cr)
+    void prefetch(int cr) const {
+        table_pair.prefetch(cr);
+        table_pair.prefetch(cross_y2_map[cr]);
+    }
+
+    // Steps 1-2: per-slot >= k counts for every (corner position, edge position)
+    void build_histograms(int cr) {
+        decode_slots(cr, (1 << n_slots) - 1);
+    }
+
+    // Steps 1-2 for the y2 image of the cross state of the last build_histograms(): slot s here
+    // reads the table entries that slot s ^ 2 (BL <-> FR, BR <-> FL) read there, so the counts
+    // of a slot whose mirror is tracked are a relabeled copy. The others are read from the table.
+    void build_histograms_mirrored(int cr) {
+        int free_edges[8], prev_free[8], edge_to_v[12];
+        free_edge_list(cr, free_edges);
+        free_edge_list(cross_y2_map[cr], prev_free);
+        for(int v = 0; v < 8; ++v) edge_to_v[prev_free[v]] = v;
+
+        std::memcpy(prev_valid, valid_ge_k, sizeof(prev_valid));
+        int decode_mask = 0;
+        for(int p = 0; p < n_slots; ++p) {
+            int q = slot_position(slot_of(p) ^ 2);
+            if(q < 0) { decode_mask |= 1 << p; continue; }
+            for(int u = 0; u < 8; ++u) {
+                for(int v = 0; v < 8; ++v) {
+                    std::memcpy(valid_ge_k[p][u][v], prev_valid[q][y2_corn[u]][edge_to_v[y2_edge[free_edges[v]]]], 14 * sizeof(int));
+                }
+            }
+        }
+        if(decode_mask) decode_slots(cr, decode_mask);
+    }
+
+    // Per-slot >= k counts of the last build_histograms()
+    const SlotCounts* slot_counts() const { return valid_ge_k; }
+
+    // Replace step 1-2 for joint histograms: lane j of slot p takes the >= d count of 'src'
+    // with d = lane_depth[p][j], so the join counts several threshold combinations at once
+    template<int SrcDepth>
+    void load_lanes(const int (*src)[8][8][SrcDepth], const int (*lane_depth)[MaxDepth]) {
+        for(int p = 0; p < n_slots; ++p) {
+            for(int u = 0; u < 8; ++u) {
+                for(int v = 0; v < 8; ++v) {
+                    for(int j = 0; j < MaxDepth; ++j) valid_ge_k[p][u][v][j] = src[p][u][v][lane_depth[p][j]];
+                }
+            }
+        }
+    }
+
+    // 3. Tabulate both sides over all assignments of the masked positions to the slots
+    void build_sides() {
+        build_side<LeftSlots>(left_masks, valid_ge_k, t_left);
+        build_side<RightSlots>(right_masks, valid_ge_k + LeftSlots, t_right);
+    }
+
+    // 4. Exact join: transform t_right so that each (left corner mask, left edge mask) holds the
+    // sum over all right masks disjoint from it on both axes, then take one dot product
+    void join_disjoint(long long* counts) {
+        long long col[n_right][MaxDepth], col_out[n_left][MaxDepth];
+        // Corner axis: s[mc][me] = sum over right corner masks disjoint from mc of t_right[.][me]
+        for(int me = 0; me < n_right; ++me) {
+            for(int mc = 0; mc < n_right; ++mc) {
+                for(int k = 0; k < MaxDepth; ++k) col[mc][k] = t_right[mc][me][k];
+            }
+            disjoint_sum_axis(col, col_out);
+            for(int mc = 0; mc < n_left; ++mc) {
+                for(int k = 0; k < MaxDepth; ++k) s[mc][me][k] = col_out[mc][k];
+            }
+        }
+        // Edge axis (rows are contiguous), fused with the final dot product
+        for(int mc = 0; mc < n_left; ++mc) {
+            disjoint_sum_axis(s[mc], col_out);
+            for(int me = 0; me < n_left; ++me) {
+                for(int k = 0; k < MaxDepth; ++k) counts[k] += t_left[mc][me][k] * col_out[me][k];
+            }
+        }
+    }
+
+private:
+    LeftMasks left_masks;
+    RightMasks right_masks;
+    // Index into sup of each subset; too large subsets point at the zero row (left side)
+    // or at the discard row (right side)
+    int left_sub[n_left][n_sub_left];
+    int right_sub[n_right][n_sub_right];
+
+    int dist_hist[4][8][8][14];
+    int valid_ge_k[4][8][8][n_hist]; // [slot][corner position][edge position][min dist, or lane]
+    LeftTable t_left;
+    RightTable t_right;
+    long long s[n_left][n_right][MaxDepth];
+
+    int prev_valid[4][8][8][n_hist];
+
+    static int pick_bits(const int* bits, int s) {
+        int m = 0;
+        for(int i = 0; s >> i; ++i) if((s >> i) & 1) m |= 1 << bits[i];
+        return m;
+    }
+
+    // Slot tracked at position p, and the position of slot s (-1 when not tracked)
+    static int slot_of(int p) { return p < LeftSlots ? p : 2 + p - LeftSlots; }
+    static int slot_position(int s) {
+        if(s < 2) return s < LeftSlots ? s : -1;
+        return s - 2 < RightSlots ? LeftSlots + s - 2 : -1;
+    }
+
+    // The 8 edge positions not taken by the cross pieces, in increasing order
+    static void free_edge_list(int cr, int* free_edges) {
+        int p_cross[4];
+        index_to_array(p_cross, cr, 4, 2, 12);
+        int mask_edges_used = 0;
+        for(int val : p_cross) mask_edges_used |= (1 << ((val / 18) / 2));
+        for(int i = 0, fe = 0; i < 12; ++i) if(!((mask_edges_used >> i) & 1)) free_edges[fe++] = i;
+    }
+
+    // Steps 1-2 for the positions in 'slot_mask' (bit p)
+    void decode_slots(int cr, int slot_mask) {
+        int free_edges[8];
+        free_edge_list(cr, free_edges);
+        int cr_rot = cross_y2_map[cr];
+
+        // 1. Histogram the tracked slots per (corner position, edge position), reading the
+        //    interleaved BL/BR blocks at cr and at its y2 image
+        std::memset(dist_hist, 0, sizeof(dist_hist));
+        const unsigned char* blk[2] = {table_pair.block(cr), table_pair.block(cr_rot)};
+        for(int p = 0; p < n_slots; ++p) {
+            if(!((slot_mask >> p) & 1)) continue;
+            bool rot = p >= LeftSlots;
+            const unsigned char* b = blk[rot];
+            int shift = ((rot ? p - LeftSlots : p) == 0) ? 0 : 4; // BL in the low nibble, BR in the high one
+            for(int u = 0; u < 8; ++u) {
+                int c_idx = 3 * (rot ? y2_corn[u] : u);
+                for(int v = 0; v < 8; ++v) {
+                    int e_idx = 2 * (rot ? y2_edge[free_edges[v]] : free_edges[v]);
+                    for(int co = 0; co < 3; ++co) {
+                        for(int eo = 0; eo < 2; ++eo) {
+                            int d = (b[(c_idx + co) * sz_ed + e_idx + eo] >> shift) & 0xF;
+                            if(d < 14) dist_hist[p][u][v][d]++;
+                        }
+                    }
+                }
+            }
+        }
+
+        // 2. Cumulative sums for the greater-than-or-equal logic
+        for(int p = 0; p < n_slots; ++p) {
+            if(!((slot_mask >> p) & 1)) continue;
+            for(int u = 0; u < 8; ++u) {
+                for(int v = 0; v < 8; ++v) {
+                    int sum = 0;
+                    for(int d = 13; d >= 0; --d) {
+                        sum += dist_hist[p][u][v][d];
+                        valid_ge_k[p][u][v][d] = sum;
+                    }
+                }
+            }
+        }
+    }
+
+    // t[mc][me][k] = sum over the assignments of the masked corner and edge positions to the
+    // slots of this side of the product of the per-slot >= k counts
+    template<int Slots, typename Masks, typename Table>
+    static void build_side(const Masks &masks, const int (*valid)[8][8][n_hist], Table &t) {
+        for(int i = 0; i < Masks::count; ++i) {
+            for(int j = 0; j < Masks::count; ++j) {
+                long long* cnt = t[i][j];
+                if(Slots == 0) {
+                    for(int k = 0; k < MaxDepth; ++k) cnt[k] = 1;
+                } else if(Slots == 1) {
+                    const int* v = valid[0][masks.bits[i][0]][masks.bits[j][0]];
+                    for(int k = 0; k < MaxDepth; ++k) cnt[k] = v[k];
+                } else {
+                    int c1 = masks.bits[i][0], c2 = masks.bits[i][Slots - 1];
+                    int e1 = masks.bits[j][0], e2 = masks.bits[j][Slots - 1];
+                    const int (*v0)[8][n_hist] = valid[0];
+                    const int (*v1)[8][n_hist] = valid[Slots - 1];
+                    for(int k = 0; k < MaxDepth; ++k) {
+                        cnt[k] = (long long)v0[c1][e1][k] * v1[c2][e2][k] + (long long)v0[c1][e2][k] * v1[c2][e1][k]
+                               + (long long)v0[c2][e1][k] * v1[c1][e2][k] + (long long)v0[c2][e2][k] * v1[c1][e1][k];
+                    }
+                }
+            }
+        }
+    }
+
+    // For every left mask A: sum of r[B] over the right masks B disjoint from A, along one axis.
+    // Inclusion-exclusion: sum_{S subset of A} (-1)^|S| * sup[S], where sup[S] sums r[B] over
+    // the right masks containing S.
+    void disjoint_sum_axis(const long long (*r)[MaxDepth], long long (*out)[MaxDepth]) const {
+        long long sup[n_sub + 2][MaxDepth];
+        std::memset(sup, 0, sizeof(sup));
+        for(int b = 0; b < n_right; ++b) {
+            for(int s = 0; s < n_sub_right; ++s) {
+                long long* sp = sup[right_sub[b][s]];
+                for(int k = 0; k < MaxDepth; ++k) sp[k] += r[b][k];
+            }
+        }
+        for(int a = 0; a < n_left; ++a) {
+            for(int k = 0; k < MaxDepth; ++k) out[a][k] = 0;
+            for(int s = 0; s < n_sub_left; ++s) {
+                const long long* sp = sup[left_sub[a][s]];
+                if(__builtin_popcount(s) & 1) {
+                    for(int k = 0; k < MaxDepth; ++k) out[a][k] -= sp[k];
+                } else {
+                    for(int k = 0; k < MaxDepth; ++k) out[a][k] += sp[k];
+                }
+            }
+        }
+    }
+
+    // Reference join: walks all disjoint (left, right) corner masks x disjoint edge masks
+    void join_reference(long long* counts) const {
+        for(int lc = 0; lc < n_left; ++lc) {
+            for(int rc = 0; rc < n_right; ++rc) {
+                if(left_masks.mask[lc] & right_masks.mask[rc]) continue;
+                for(int le = 0; le < n_left; ++le) {
+                    for(int re = 0; re < n_right; ++re) {
+                        if(left_masks.mask[le] & right_masks.mask[re]) continue;
+                        for(int k = 0; k < MaxDepth; ++k) counts[k] += t_left[lc][le][k] * t_right[rc][re][k];
+                    }
+                }
+            }
+        }
+    }
+};
+
+// =========================================================================================
+// Joint Histograms
+// =========================================================================================
+// Optional second output of the same pass, kept as >= counts like the marginal one:
+//   cross[c][k]   placements of the cross states at cross distance c with min >= k
+//   slot[s][a][k] placements with xcross(s) >= a and min >= k, for each tracked slot s
+// slot[s][a][k] for a > k needs its own join: the per-slot counts are loaded into lanes
+// (a, k) with threshold a on slot s and k on the others, all 66 lanes in one join per slot.
+const int n_joint_lanes = n_depth * (n_depth - 1) / 2;
+
+struct JointCounts {
+    long long cross[n_depth][n_depth] = {{0}};
+    long long slot[4][n_depth][n_depth] = {{{0}}};
+};
+
+template<int LeftSlots, int RightSlots>
+class JointAggregator {
+public:
+    static constexpr int n_slots = LeftSlots + RightSlots;
+    typedef Aggregator<LeftSlots, RightSlots, n_joint_lanes> LaneAggregator;
+
+    JointAggregator() {
+        for(int p = 0; p < n_slots; ++p) slot_of[p] = p < LeftSlots ? p : 2 + p - LeftSlots;
+        for(int p = 0; p < n_slots; ++p) {
+            for(int j = 0, a = 1; a < n_depth; ++a) {
+                for(int k = 0; k < a; ++k, ++j) {
+                    for(int q = 0; q < n_slots; ++q) lane_depth[p][q][j] = q == p ? a : k;
+                }
+            }
+        }
+    }
+
+    // Add cross task 't' to 'out', given the histograms left in 'agg' and its >= k counts
+    template<typename Agg>
+    void add(int t, const Agg &agg, const long long* counts, JointCounts &out) {
+        long long w = cross_weights[t];
+        int c = table_cross[cross_tasks[t]];
+        for(int k = 0; k < n_depth; ++k) out.cross[c][k] += w * counts[k];
+
+        // J[p][a][k] at the representative; a <= k is implied by min >= k
+        long long J[4][n_depth][n_depth];
+        for(int p = 0; p < n_slots; ++p) {
+            lanes.load_lanes(agg.slot_counts(), lane_depth[p]);
+            lanes.build_sides();
+            long long lane_counts[n_joint_lanes] = {0};
+            lanes.join_disjoint(lane_counts);
+            for(int j = 0, a = 0; a < n_depth; ++a) {
+                for(int k = 0; k < n_depth; ++k) J[p][a][k] = k < a ? lane_counts[j++] : counts[k];
+            }
+        }
+
+        // The task stands for the orbit of its representative: summed over the group, slot s
+        // of the image g.rep reads slot g(s) of rep, and every orbit member is hit |G| / w times
+        int n_group = __builtin_popcount(cross_group), pos_of[4] = {-1, -1, -1, -1};
+        for(int p = 0; p < n_slots; ++p) pos_of[slot_of[p]] = p;
+        for(int p = 0; p < n_slots; ++p) {
+            long long acc[n_depth][n_depth] = {{0}};
+            for(int g = 0; g < n_sym; ++g) {
+                if(!((cross_group >> g) & 1)) continue;
+                const long long (*src)[n_depth] = J[pos_of[slot_image(g, slot_of[p])]];
+                for(int a = 0; a < n_depth; ++a) for(int k = 0; k < n_depth; ++k) acc[a][k] += src[a][k];
+            }
+            long long stab = n_group / w;
+            for(int a = 0; a < n_depth; ++a) for(int k = 0; k < n_depth; ++k) out.slot[slot_of[p]][a][k] += acc[a][k] / stab;
+        }
+    }
+
+private:
+    int slot_of[4];
+    int lane_depth[4][4][n_joint_lanes]; // [slot with threshold a][slot][lane]
+    LaneAggregator lanes;
+};
+
+// Run the aggregator over cross tasks [t_begin, t_end), adding the weighted >= k counts to total_counts
+// and, with 'joint', the joint histograms
+template<int LeftSlots, int RightSlots>
+void run_aggregator(int t_begin, int t_end, long long* total_counts, int verify_join_stride, long long &verified, long long &mismatches,
+                    JointCounts* joint) {
+    #pragma omp parallel reduction(+:verified, mismatches)
+    {
+        long long local_counts[n_depth] = {0};
+        // Per-thread scratch (~300 KB for 2 + 2 slots), kept off the stack
+        Aggregator<LeftSlots, RightSlots, n_depth>* agg = new Aggregator<LeftSlots, RightSlots, n_depth>();
+        JointAggregator<LeftSlots, RightSlots>* joint_agg = joint ? new JointAggregator<LeftSlots, RightSlots>() : nullptr;
+        JointCounts* local_joint = joint ? new JointCounts() : nullptr;
+        int last_task = -2;
+
+        #pragma omp for schedule(dynamic, 100)
+        for (int t = t_begin; t < t_end; ++t) {
+            long long counts[n_depth] = {0};
+            bool verify = verify_join_stride > 0 && t % verify_join_stride == 0;
+            bool mismatch = false;
+            bool mirrored = cross_task_mirrors[t] && last_task == t - 1;
+            last_task = t;
+            PROFILE_TASK(t);
+            if (t + 1 < t_end && !cross_task_mirrors[t + 1]) agg->prefetch(cross_tasks[t + 1]);
+            agg->process(cross_tasks[t], counts, verify, mismatch, mirrored);
+            for(int k = 0; k < n_depth; ++k) local_counts[k] += cross_weights[t] * counts[k];
+            if(joint_agg) joint_agg->add(t, *agg, counts, *local_joint);
+            if(verify) {
+                verified++;
+                if(mismatch) mismatches++;
+            }
+        }
+        delete agg;
+        delete joint_agg;
+
+        #pragma omp critical
+        {
+            for(int d = 0; d < n_depth; ++d) total_counts[d] += local_counts[d];
+            if(joint) {
+                for(int c = 0; c < n_depth; ++c) for(int k = 0; k < n_depth; ++k) joint->cross[c][k] += local_joint->cross[c][k];
+                for(int s = 0; s < 4; ++s) {
+                    for(int a = 0; a < n_depth; ++a) for(int k = 0; k < n_depth; ++k) joint->slot[s][a][k] += local_joint->slot[s][a][k];
+                }
+            }
+        }
+        delete local_joint;
+    }
+}
+
+// Dispatch a runtime slot configuration (validated by the caller) to its aggregator
+void aggregate_tasks(int left_slots, int right_slots, int t_begin, int t_end, long long* total_counts,
+                     int verify_join_stride, long long &verified, long long &mismatches, JointCounts* joint = nullptr) {
+    switch (left_slots * 10 + right_slots) {
+        case 10: run_aggregator<1, 0>(t_begin, t_end, total_counts, verify_join_stride, verified, mismatches, joint); break;
+        case 20: run_aggregator<2, 0>(t_begin, t_end, total_counts, verify_join_stride, verified, mismatches, joint); break;
+        case 11: run_aggregator<1, 1>(t_begin, t_end, total_counts, verify_join_stride, verified, mismatches, joint); break;
+        case 21: run_aggregator<2, 1>(t_begin, t_end, total_counts, verify_join_stride, verified, mismatches, joint); break;
+        default: run_aggregator<2, 2>(t_begin, t_end, total_counts, verify_join_stride, verified, mismatches, joint); break;
+    }
+}
+
+// =========================================================================================
+// PART 5: Batch Scramble Solver (IDA*)
+// =========================================================================================
+
+// Target slot subsets in cross_table.sql column order (bit s = slot s: BL, BR, FR, FL)
+const int num_targets = 15;
+const int target_masks[num_targets] = {0, 1, 2, 4, 8, 3, 5, 9, 6, 10, 12, 7, 11, 13, 14};
+
+// Cross colors in cross_table.sql column order (Y, W, O, R, G, B), given as the face each
+// original face lands on after the whole-cube rotation None, z2, z', z, x', x.
+// Faces are indexed in move_names order: U, D, L, R, F, B.
+const int num_colors = 6;
+const int rot_face[num_colors][6] = {
+    {0, 1, 2, 3, 4, 5}, // Y: None
+    {1, 0, 3, 2, 4, 5}, // W: z2
+    {2, 3, 1, 0, 4, 5}, // O: z'
+    {3, 2, 0, 1, 4, 5}, // R: z
+    {4, 5, 2, 3, 1, 0}, // G: x'
+    {5, 4, 2, 3, 0, 1}  // B: x
+};
+const int num_results = num_colors * num_targets; // 90 values per scramble
+const int max_solve_depth = 20;
+
+// Analyzer variants of prompt.md as compile-time coordinate policies. One solver engine is
+// instantiated per policy, so every goal test and loop bound below is a constant of the variant:
+//   n_offsets  D-layer offsets accepted for the cross (4 for pseudo: the D layer may be turned,
+//              the corners count as solved relative to the cross; the slots of a target give
+//              its E-layer edges, which go with the same number of D-layer corners, any of them)
+//   track_eo   the goal also needs all 12 edges oriented (EO-cross)
+//   free_pair  the goal also needs one slot outside the target to be a free pair
+// The pruning tables of the pseudo variants are separate files (BFS from all four offsets).
+struct StdVariant {
+    static const char* name() { return "std"; }
+    static const int n_offsets = 1;
+    static const bool track_eo = false;
+    static const bool free_pair = false;
+};
+
+struct PseudoVariant {
+    static const char* name() { return "pseudo"; }
+    static const int n_offsets = 4;
+    static const bool track_eo = false;
+    static const bool free_pair = false;
+};
+
+struct EoVariant {
+    static const char* name() { return "eo"; }
+    static const int n_offsets = 1;
+    static const bool track_eo = true;
+    static const bool free_pair = false;
+};
+
+struct PairVariant {
+    static const char* name() { return "pair"; }
+    static const int n_offsets = 1;
+    static const bool track_eo = false;
+    static const bool free_pair = true;
+};
+
+struct PseudoPairVariant {
+    static const char* name() { return "pseudo-pair"; }
+    static const int n_offsets = 4;
+    static const bool track_eo = false;
+    static const bool free_pair = true;
+};
+
+// Call f(Variant()) for the policy named 'name'; false if there is none
+template<typename F>
+bool with_variant(const std::string &name, F f) {
+    if(name == StdVariant::name()) f(StdVariant());
+    else if(name == PseudoVariant::name()) f(PseudoVariant());
+    else if(name == EoVariant::name()) f(EoVariant());
+    else if(name == PairVariant::name()) f(PairVariant());
+    else if(name == PseudoPairVariant::name()) f(PseudoPairVariant());
+    else return false;
+    return true;
+}
+
+void generate_cross_table(const std::vector<int> &mt_multi, int n_offsets) {
+    table_cross.assign(sz_cr, 255);
+    for(int d = 0, cr = 187520; d < n_offsets; ++d, cr = mt_multi[cr * 24 + move_d] / 24) table_cross[cr] = 0;
+    for(int depth = 0; ; ++depth) {
+        long long count = 0;
+        for(int i = 0; i < sz_cr; ++i) {
+            if(table_cross[i] != depth) continue;
+            for(int j = 0; j < 18; ++j) {
+                int ni = mt_multi[i * 24 + j] / 24;
+                if(table_cross[ni] == 255) { table_cross[ni] = depth + 1; count++; }
+            }
+        }
+        if(count == 0) break;
+    }
+}
+
+// Edge orientation coordinate (EO variant): bit i = orientation of the edge at position i < 11,
+// the last one follows from parity. Move table and distance to all edges oriented.
+const int sz_eo = 2048;
+std::vector<int> mt_eo;
+std::vector<unsigned char> table_eo;
+
+void generate_eo_tables() {
+    mt_eo.assign(sz_eo * 18, 0);
+    for(int i = 0; i < sz_eo; ++i) {
+        State s = State::solved();
+        for(int e = 0; e < 11; ++e) {
+            s.eo[e] = (i >> e) & 1;
+            s.eo[11] ^= s.eo[e];
+        }
+        for(int j = 0; j < 18; ++j) {
+            State ns = s.apply_move(move_states.m[j]);
+            int next = 0;
+            for(int e = 0; e < 11; ++e) next |= ns.eo[e] << e;
+            mt_eo[i * 18 + j] = next;
+        }
+    }
+    
+    table_eo.assign(sz_eo, 255);
+    table_eo[0] = 0;
+    for(int depth = 0, count = 1; count; ++depth) {
+        count = 0;
+        for(int i = 0; i < sz_eo; ++i) {
+            if(table_eo[i] != depth) continue;
+            for(int j = 0; j < 18; ++j) {
+                int ni = mt_eo[i * 18 + j];
+                if(table_eo[ni] == 255) { table_eo[ni] = depth + 1; count++; }
+            }
+        }
+    }
+}
+
+// Free pairs (pair variants): pair_ready[q * sz_block + cn * sz_ed + ed] is set when a corner at
+// cn and an edge at ed can be placed into slot q by an optional U turn followed by f U f' or
+// f U' f', f being a side face of the slot turned so that it lifts the slot into the U layer
+// (e.g. L U L', B' U B for BL), or are in place already
+std::vector<unsigned char> pair_ready;
+
+void generate_pair_table(const std::vector<int> &mt_corn, const std::vector<int> &mt_edge) {
+    pair_ready.assign(4 * sz_block, 0);
+    for(int q = 0; q < 4; ++q) {
+        int home_cn = 3 * (4 + q), home_ed = 2 * q;
+        std::vector<std::vector<int>> inserts = {{}};
+        for(int f : slot_faces[q]) {
+            int up = mt_corn[home_cn * 18 + 3 * f] / 3 < 4 ? 3 * f : 3 * f + 2;
+            int down = 3 * f + (2 - up % 3);
+            inserts.push_back({up, 0, down});
+            inserts.push_back({up, 2, down});
+        }
+        for(int cn = 0; cn < sz_cn; ++cn) {
+            for(int ed = 0; ed < sz_ed; ++ed) {
+                bool ready = false;
+                for(int adjust = -1; adjust < 3 && !ready; ++adjust) {
+                    for(const auto &seq : inserts) {
+                        int c = cn, e = ed;
+                        if(adjust >= 0) { c = mt_corn[c * 18 + adjust]; e = mt_edge[e * 18 + adjust]; }
+                        for(int m : seq) { c = mt_corn[c * 18 + m]; e = mt_edge[e * 18 + m]; }
+                        if(c == home_cn && e == home_ed) { ready = true; break; }
+                    }
+                }
+                pair_ready[q * sz_block + cn * sz_ed + ed] = ready;
+            }
+        }
+    }
+}
+
+// Tables the solver of a variant reads besides the BL/BR pruning tables
+template<typename Variant>
+void generate_solver_tables(const std::vector<int> &mt_multi, const std::vector<int> &mt_corn, const std::vector<int> &mt_edge) {
+    generate_cross_table(mt_multi, Variant::n_offsets);
+    if(Variant::track_eo) generate_eo_tables();
+    if(Variant::free_pair) generate_pair_table(mt_corn, mt_edge);
+    if(Variant::n_offsets > 1) {
+        // Mixed corner / edge pairs, e.g. prune_table_bl_dbr_pseudo.bin: BL edge + DBR corner
+        static const char* slots[4] = {"bl", "br", "fr", "fl"};
+        for(int q = 0; q < 2; ++q) {
+            for(int k = 0; k < 4; ++k) {
+                if(k == q) continue;
+                std::string id = std::string(slots[q]) + "_d" + slots[k];
+                load_or_generate_table(table_mixed[k][q], 187520, 3 * (4 + k), 2 * q, mt_multi, mt_corn, mt_edge,
+                                       "Table " + id, "prune_table_" + id + "_pseudo.bin", Variant::n_offsets);
+            }
+        }
+    }
+}
+
+// Parse "R U2 F' ..." into indices of move_names; returns false on an unknown token. Tokens
+// are decoded in place, so a reused 'moves' vector makes parsing allocation-free.
+bool parse_scramble(const std::string &scramble, std::vector<int> &moves) {
+    moves.clear();
+    size_t i = 0, n = scramble.size();
+    while(i < n) {
+        while(i < n && std::isspace((unsigned char)scramble[i])) ++i;
+        size_t j = i;
+        while(j < n && !std::isspace((unsigned char)scramble[j])) ++j;
+        if(j > i) {
+            const char* face = std::strchr("UDLRFB", scramble[i]);
+            if(!face || !*face || j - i > 2) return false;
+            int pow = 0;
+            if(j - i == 2) {
+                if(scramble[i + 1] == '2') pow = 1;
+                else if(scramble[i + 1] == '\'') pow = 2;
+                else return false;
+            }
+            moves.push_back(3 * (face - "UDLRFB") + pow);
+        }
+        i = j;
+    }
+    return true;
+}
+
+// A move as seen after a whole-cube rotation: the turn moves to the face its original face
+// lands on (rotations preserve the turn direction)
+inline int rotate_move(int m, int color) {
+    return 3 * rot_face[color][m / 3] + m % 3;
+}
+
+// Coordinates tracked by the solver: the cross, plus the corner (C4..C7) and edge (E0..E3)
+// of each F2L slot, in the single-piece encoding of mt_corn / mt_edge, and the edge
+// orientation when the variant tracks it
+struct SolverCoord {
+    int cr;
+    int cn[4];
+    int ed[4];
+    int eo;
+};
+
+// IDA* solver for cross + any subset of slots, driven by table_cross and the BL/BR
+// pruning tables (FR/FL are looked up through the y2 conjugation)
+template<typename Variant>
+class ScrambleSolver {
+public:
+    ScrambleSolver(const std::vector<int> &multi, const std::vector<int> &corn, const std::vector<int> &edge)
+        : mt_multi(multi), mt_corn(corn), mt_edge(edge) 
+    {
+        // Solved cross of each accepted D-layer offset, where each slot corner k is then solved
+        // relative to it, and which slot corner that puts in slot q
+        for(int d = 0, cr = 187520; d < Variant::n_offsets; ++d, cr = mt_multi[cr * 24 + move_d] / 24) {
+            cross_goal[d] = cr;
+            for(int k = 0; k < 4; ++k) {
+                int c = 3 * (4 + k);
+                for(int i = 0; i < d; ++i) c = mt_corn[c * 18 + move_d];
+                offset_home[d][k] = c;
+                offset_corner[d][c / 3 - 4] = k;
+            }
+        }
+        for(int k = 0; k < 4; ++k) {
+            for(int q = 0; q < 2; ++q) pseudo_tables[k][q] = k == q ? (q == 0 ? &table_bl : &table_br) : &table_mixed[k][q];
+        }
+    }
+
+    SolverCoord solved() const {
+        SolverCoord c;
+        c.cr = 187520;
+        for(int s = 0; s < 4; ++s) { c.cn[s] = 3 * (4 + s); c.ed[s] = 2 * s; }
+        c.eo = 0;
+        return c;
+    }
+
+    inline SolverCoord apply(const SolverCoord &c, int m) const {
+        SolverCoord n;
+        n.cr = mt_multi[c.cr * 24 + m] / 24;
+        for(int s = 0; s < 4; ++s) {
+            n.cn[s] = mt_corn[c.cn[s] * 18 + m];
+            n.ed[s] = mt_edge[c.ed[s] * 18 + m];
+        }
+        n.eo = Variant::track_eo ? mt_eo[c.eo * 18 + m] : 0;
+        return n;
+    }
+
+    // Coordinates after 'moves' as seen from the given cross color
+    SolverCoord from_moves(const std::vector<int> &moves, int color = 0) const {
+        SolverCoord c = solved();
+        for(int m : moves) c = apply(c, rotate_move(m, color));
+        return c;
+    }
+
+    // xcross distance of slot s (BL, BR direct; FR, FL via y2 onto BL, BR)
+    inline int slot_dist(const SolverCoord &c, int s) const {
+        if(s < 2) {
+            long long idx = ((long long)c.cr * sz_cn + c.cn[s]) * sz_ed + c.ed[s];
+            return (s == 0 ? table_bl : table_br).get(idx);
+        }
+        int cn = 3 * y2_corn[c.cn[s] / 3] + c.cn[s] % 3;
+        int ed = 2 * y2_edge[c.ed[s] / 2] + c.ed[s] % 2;
+        long long idx = ((long long)cross_y2_map[c.cr] * sz_cn + cn) * sz_ed + ed;
+        return (s == 2 ? table_bl : table_br).get(idx);
+    }
+
+    // Pseudo distance of the corner of slot k and the edge of slot q (FR/FL edges via y2)
+    inline int mixed_dist(const SolverCoord &c, int k, int q) const {
+        if(q < 2) return pseudo_tables[k][q]->get(((long long)c.cr * sz_cn + c.cn[k]) * sz_ed + c.ed[q]);
+        int cn = 3 * y2_corn[c.cn[k] / 3] + c.cn[k] % 3;
+        int ed = 2 * y2_edge[c.ed[q] / 2] + c.ed[q] % 2;
+        return pseudo_tables[k ^ 2][q ^ 2]->get(((long long)cross_y2_map[c.cr] * sz_cn + cn) * sz_ed + ed);
+    }
+
+    // Admissible estimate: every slot in the mask needs at least its xcross distance. Pseudo
+    // goals need the edges of the mask with as many corners, any of them: each corner needs at
+    // least its largest distance over those edges, and the goal the smallest such bound among
+    // the corners it keeps. Zero means solved unless the variant asks for a free pair.
+    inline int heuristic(const SolverCoord &c, int mask) const {
+        int h = table_cross[c.cr];
+        if(Variant::track_eo) h = std::max(h, (int)table_eo[c.eo]);
+        if(Variant::n_offsets > 1) {
+            if(mask) {
+                int need[4] = {0, 0, 0, 0};
+                for(int k = 0; k < 4; ++k) {
+                    for(int q = 0; q < 4; ++q) {
+                        if((mask >> q) & 1) need[k] = std::max(need[k], mixed_dist(c, k, q));
+                    }
+                }
+                std::sort(need, need + 4);
+                h = std::max(h, need[__builtin_popcount(mask) - 1]);
+            }
+            return h;
+        }
+        for(int s = 0; s < 4; ++s) {
+            if((mask >> s) & 1) h = std::max(h, slot_dist(c, s));
+        }
+        // A free pair is at most 4 moves from its xcross
+        if(Variant::free_pair && mask != 15) {
+            int pair = NIBBLE_EMPTY;
+            for(int q = 0; q < 4; ++q) {
+                if(!((mask >> q) & 1)) pair = std::min(pair, slot_dist(c, q));
+            }
+            h = std::max(h, pair - 4);
+        }
+        return h;
+    }
+
+    // Called where the heuristic is zero: the cross and the masked slots are solved. A free
+    // pair goes into slot q with the corner that is solved there relative to the cross; for
+    // pseudo goals that corner must not be one the masked edges need.
+    inline bool goal(const SolverCoord &c, int mask) const {
+        if(!Variant::free_pair) return true;
+        int d = 0;
+        while(d + 1 < Variant::n_offsets && cross_goal[d] != c.cr) ++d;
+        int solved_corners = 0;
+        for(int k = 0; k < 4; ++k) solved_corners += c.cn[k] == offset_home[d][k];
+        for(int q = 0; q < 4; ++q) {
+            int k = offset_corner[d][q];
+            if((mask >> q) & 1) continue;
+            if(Variant::n_offsets > 1 ? solved_corners - (c.cn[k] == offset_home[d][k]) < __builtin_popcount(mask) : (mask >> k) & 1) continue;
+            if(pair_ready[q * sz_block + c.cn[k] * sz_ed + c.ed[q]]) return true;
+        }
+        return false;
+    }
+
+    // Optimal number of moves to solve the cross plus the slots in 'mask', given a known lower bound
+    // (-1 when longer than max_solve_depth or cut off by the deadline, see timed_out)
+    int solve(const SolverCoord &start, int mask, int lower = 0) {
+        for(int bound = std::max(heuristic(start, mask), lower); bound <= max_solve_depth && !timed_out(); ++bound) {
+            if(search(start, 0, bound, mask, -1)) return bound;
+        }
+        return -1;
+    }
+
+    // Abandon searches running past 'when'; checked every few thousand nodes
+    void set_deadline(std::chrono::steady_clock::time_point when) {
+        deadline = when;
+        expired = false;
+    }
+    bool timed_out() const { return expired; }
+
+    // All 90 values of one scramble, in cross_table.sql column order. Every goal of a mask is
+    // also a goal of its subsets, which come first in target order, so their results seed the
+    // IDA* threshold (and a subset without a solution settles the mask too).
+    void solve_scramble(const std::vector<int> &moves, int out[num_results]) {
+        for(int color = 0; color < num_colors; ++color) {
+            SolverCoord start = from_moves(moves, color);
+            int* res = out + color * num_targets;
+            for(int t = 0; t < num_targets; ++t) {
+                int lower = 0;
+                for(int u = 0; u < t && lower >= 0; ++u) {
+                    if((target_masks[u] & ~target_masks[t]) == 0) lower = res[u] < 0 ? -1 : std::max(lower, res[u]);
+                }
+                res[t] = lower < 0 ? -1 : solve(start, target_masks[t], lower);
+            }
+        }
+    }
+
+private:
+    bool search(const SolverCoord &c, int g, int bound, int mask, int last_face) {
+        if((++nodes & 4095) == 0 && std::chrono::steady_clock::now() >= deadline) expired = true;
+        if(expired) return false;
+        int h = heuristic(c, mask);
+        if(h == 0 && goal(c, mask)) return true;
+        if(g + std::max(h, 1) > bound) return false;
+        for(int m = 0; m < 18; ++m) {
+            int face = m / 3;
+            // Skip repeated faces, and fix the order of commuting opposite faces
+            if(face == last_face || ((face ^ 1) == last_face && face < last_face)) continue;
+            if(search(apply(c, m), g + 1, bound, mask, face)) return true;
+        }
+        return false;
+    }
+
+    const std::vector<int> &mt_multi;
+    const std::vector<int> &mt_corn;
+    const std::vector<int> &mt_edge;
+    int cross_goal[Variant::n_offsets];
+    int offset_home[Variant::n_offsets][4];
+    int offset_corner[Variant::n_offsets][4];
+    const NibbleTable* pseudo_tables[4][2];
+    std::chrono::steady_clock::time_point deadline = std::chrono::steady_clock::time_point::max();
+    bool expired = false;
+    unsigned nodes = 0;
+};
+
+// Append "id,<90 values>" and the line end (empty fields for an unparsable scramble)
+void append_result_row(std::string &out, const std::string &id, const int* values, bool valid, const char* eol = "\n") {
+    out += id;
+    for(int k = 0; k < num_results; ++k) {
+        out += ',';
+        if(valid) out += std::to_string(values[k]);
+    }
+    out += eol;
+}
+
+// =========================================================================================
+// Persistent Result Store
+// =========================================================================================
+// --store FILE keeps every solved scramble in an append-only binary file, so --stream / --solve
+// runs over a refreshed WCA export only solve the ids that are new. --export FILE OUT.csv
+// writes the whole store back as "id,<90 values>" rows.
+// Layout: StoreHeader, then fixed-size records (u64 id, 90 values as bytes, 255 = not found
+// within max_solve_depth). A record torn by an interrupted run is cut off when the store is
+// opened; if an id occurs twice the later record wins.
+
+const char STORE_MAGIC[8] = {'X', 'C', 'R', 'E', 'S', 'U', 'L', 'T'};
+const uint32_t STORE_VERSION = 1;
+
+struct StoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t n_values;   // Values per record (num_results)
+    char variant[16];    // Analyzer variant the values belong to
+};
+
+const size_t store_record_bytes = sizeof(uint64_t) + num_results;
+
+// Numeric scramble id at the start of 's' (up to the first ','), as used by cross_table. At
+// most 19 digits, so the key cannot overflow; longer ids are not stored.
+bool parse_store_key(const std::string &s, uint64_t &key) {
+    size_t n = 0;
+    key = 0;
+    while(n < s.size() && n < 19 && s[n] >= '0' && s[n] <= '9') key = key * 10 + (s[n++] - '0');
+    return n > 0 && (n == s.size() || s[n] == ',');
+}
+
+class ResultStore {
+public:
+    // Load the index of an existing store (or create it) and prepare for appending. Read-only:
+    // the store must exist and is left untouched, a torn tail is only skipped in memory.
+    bool open(const std::string &store_path, const std::string &variant, bool read_only = false) {
+        path = store_path;
+        StoreHeader expected;
+        std::memset(&expected, 0, sizeof(expected));
+        std::memcpy(expected.magic, STORE_MAGIC, sizeof(STORE_MAGIC));
+        expected.version = STORE_VERSION;
+        expected.n_values = num_results;
+        std::strncpy(expected.variant, variant.c_str(), sizeof(expected.variant) - 1);
+        
+        std::ifstream in(path, std::ios::binary);
+        if(!in && read_only) {
+            std::cerr << "[Error] Cannot read result store " << path << std::endl;
+            return false;
+        } else if(!in) {
+            std::ofstream create(path, std::ios::binary);
+            create.write((const char*)&expected, sizeof(expected));
+            if(!create.flush()) return false;
+        } else {
+            StoreHeader h;
+            if(!in.read((char*)&h, sizeof(h)) || std::memcmp(&h, &expected, sizeof(h)) != 0) {
+                std::cerr << "[Error] " << path << " is not a result store for variant " << variant << std::endl;
+                return false;
+            }
+            std::vector<char> rec(store_record_bytes);
+            while(in.read(rec.data(), rec.size())) {
+                uint64_t id;
+                std::memcpy(&id, rec.data(), sizeof(id));
+                index.push_back({id, (uint32_t)(values.size() / num_results)});
+                values.insert(values.end(), rec.begin() + sizeof(id), rec.end());
+            }
+            in.close();
+            
+            uintmax_t valid_bytes = sizeof(StoreHeader) + index.size() * store_record_bytes;
+            if(std::filesystem::file_size(path) != valid_bytes) {
+                std::cerr << "[Warning] " << (read_only ? "Skipping" : "Dropping") << " a torn record at the end of " << path << std::endl;
+                if(!read_only) std::filesystem::resize_file(path, valid_bytes);
+            }
+            // Sorted by id, the latest record of an id first
+            std::stable_sort(index.begin(), index.end(), [](const std::pair<uint64_t, uint32_t> &a, const std::pair<uint64_t, uint32_t> &b) {
+                return a.first < b.first || (a.first == b.first && a.second > b.second);
+            });
+            index.erase(std::unique(index.begin(), index.end(), [](const std::pair<uint64_t, uint32_t> &a, const std::pair<uint64_t, uint32_t> &b) {
+                return a.first == b.first;
+            }), index.end());
+        }
+        if(read_only) return true;
+        out.open(path, std::ios::binary | std::ios::app);
+        return (bool)out;
+    }
+
+    size_t size() const { return index.size(); }
+
+    // Copy the stored values of 'id'; false if it has not been solved yet
+    bool find(uint64_t id, int* result) const {
+        auto it = std::lower_bound(index.begin(), index.end(), std::make_pair(id, (uint32_t)0), 
+            [](const std::pair<uint64_t, uint32_t> &a, const std::pair<uint64_t, uint32_t> &b) { return a.first < b.first; });
+        if(it == index.end() || it->first != id) return false;
+        const unsigned char* v = &values[(size_t)it->second * num_results];
+        for(int k = 0; k < num_results; ++k) result[k] = v[k] == 255 ? -1 : v[k];
+        return true;
+    }
+
+    // Records are buffered until flush()
+    void append(uint64_t id, const int* result) {
+        char rec[store_record_bytes];
+        std::memcpy(rec, &id, sizeof(id));
+        for(int k = 0; k < num_results; ++k) rec[sizeof(id) + k] = (char)(result[k] < 0 ? 255 : result[k]);
+        out.write(rec, sizeof(rec));
+    }
+
+    bool flush() { return (bool)out.flush(); }
+
+    // Stored rows in id order
+    template<typename F>
+    void for_each(F f) const {
+        int result[num_results];
+        for(const auto &e : index) {
+            const unsigned char* v = &values[(size_t)e.second * num_results];
+            for(int k = 0; k < num_results; ++k) result[k] = v[k] == 255 ? -1 : v[k];
+            f(e.first, result);
+        }
+    }
+
+private:
+    std::string path;
+    std::vector<std::pair<uint64_t, uint32_t>> index; // (id, record number)
+    std::vector<unsigned char> values;
+    std::ofstream out;
+};
+
+// Write every stored scramble as "id,<90 values>" in id order (the --solve CSV format)
+bool export_store(const std::string &store_path, const std::string &out_path) {
+    std::ifstream in(store_path, std::ios::binary);
+    StoreHeader h;
+    if(!in.read((char*)&h, sizeof(h)) || std::memcmp(h.magic, STORE_MAGIC, sizeof(STORE_MAGIC)) != 0) {
+        std::cerr << "[Error] Cannot read result store " << store_path << std::endl;
+        return false;
+    }
+    in.close();
+    std::string variant(h.variant, strnlen(h.variant, sizeof(h.variant)));
+    ResultStore store;
+    if(!store.open(store_path, variant, true)) return false;
+    
+    std::ofstream out(out_path, std::ios::binary);
+    std::string row;
+    store.for_each([&](uint64_t id, const int* result) {
+        row.clear();
+        append_result_row(row, std::to_string(id), result, true);
+        out << row;
+    });
+    std::cout << "[Export] " << store_path << " (" << variant << "): " << store.size() << " scrambles -> " << out_path << std::endl;
+    return (bool)out;
+}
+
+// Solve every "id,scramble" line of the input files (as written by wca_scramble_processor.py)
+// and write "id,<90 values>" rows to <input>.csv, matching the cross_table.sql column order
+template<typename Variant>
+void run_batch_solver(const std::vector<std::string> &files, 
+    const std::vector<int> &mt_multi, const std::vector<int> &mt_corn, const std::vector<int> &mt_edge, ResultStore* store) 
+{
+    for(const std::string &in_path : files) {
+        std::ifstream in(in_path);
+        if(!in) {
+            std::cerr << "[Solve] Cannot open " << in_path << std::endl;
+            continue;
+        }
+        std::vector<std::string> ids, scrambles;
+        std::string line;
+        while(std::getline(in, line)) {
+            if(!line.empty() && line.back() == '\r') line.pop_back();
+            size_t comma = line.find(',');
+            if(comma == std::string::npos) continue;
+            ids.push_back(line.substr(0, comma));
+            scrambles.push_back(line.substr(comma + 1));
+        }
+        
+        size_t dot = in_path.find_last_of('.');
+        size_t slash = in_path.find_last_of("/\\");
+        std::string out_path = (dot != std::string::npos && (slash == std::string::npos || dot > slash) 
+                                ? in_path.substr(0, dot) : in_path) + ".csv";
+        
+        std::cout << "[Solve] " << in_path << ": " << ids.size() << " scrambles..." << std::flush;
+        auto t_start = std::chrono::high_resolution_clock::now();
+        
+        long long n = ids.size();
+        std::vector<int> results(n * num_results, -1);
+        std::vector<char> valid(n, 0);
+        std::vector<char> stored(n, 0);
+        long long n_stored = 0;
+        if(store) {
+            for(long long i = 0; i < n; ++i) {
+                uint64_t key;
+                stored[i] = parse_store_key(ids[i], key) && store->find(key, &results[i * num_results]);
+                valid[i] = stored[i];
+                n_stored += stored[i];
+            }
+        }
+        
+        #pragma omp parallel
+        {
+            ScrambleSolver<Variant> solver(mt_multi, mt_corn, mt_edge);
+            std::vector<int> moves;
+            
+            #pragma omp for schedule(dynamic, 1)
+            for(long long i = 0; i < n; ++i) {
+                if(stored[i] || !parse_scramble(scrambles[i], moves)) continue;
+                solver.solve_scramble(moves, &results[i * num_results]);
+                valid[i] = 1;
+            }
+        }
+        
+        std::ofstream out(out_path);
+        std::string row;
+        for(long long i = 0; i < n; ++i) {
+            row.clear();
+            append_result_row(row, ids[i], &results[i * num_results], valid[i]);
+            out << row;
+            if(!valid[i]) std::cerr << "\n[Warning] Unparsable scramble for id " << ids[i] << ": " << scrambles[i];
+            uint64_t key;
+            if(store && valid[i] && !stored[i] && parse_store_key(ids[i], key)) store->append(key, &results[i * num_results]);
+        }
+        if(store && !store->flush()) std::cerr << "\n[Warning] Could not append to the result store";
+        
+        std::chrono::duration<double> t_el = std::chrono::high_resolution_clock::now() - t_start;
+        if(store) std::cout << " " << n_stored << " already stored.";
+        std::cout << " Done. (-> " << out_path << ", Time: " << std::fixed << std::setprecision(2) << t_el.count() 
+                  << "s, " << (int)(n / std::max(t_el.count(), 1e-9)) << " scrambles/s)" << std::endl;
+    }
+}
+
+// =========================================================================================
+// PART 6: Sharded Runs (Checkpoints & Merge)
+// =========================================================================================
+// A shard processes the cross coordinates [cr_begin, cr_end). Its progress and partial
+// >= k counts live in a small text file that is rewritten after every chunk of tasks, so a
+// killed run resumes from its last chunk, and finished shards merge into the final table.
+
+const char* SHARD_MAGIC = "xcross-shard";
+const int SHARD_VERSION = 3;
+const int shard_chunk = 2000; // Tasks between checkpoints
+
+struct ShardState {
+    std::string variant = "std";
+    int left_slots = 2, right_slots = 2;
+    int symmetry = 1;
+    std::string schedule = "plain"; // Task order; only a resumed run depends on it
+    int cr_begin = 0, cr_end = sz_cr;
+    long long next_task = 0, n_tasks = 0;
+    long long counts[n_depth] = {0};
+};
+
+// Shards can only be resumed / merged together when they count the same thing
+bool same_shard_config(const ShardState &a, const ShardState &b) {
+    return a.variant == b.variant && a.left_slots == b.left_slots && a.right_slots == b.right_slots && a.symmetry == b.symmetry &&
+           a.schedule == b.schedule && a.cr_begin == b.cr_begin && a.cr_end == b.cr_end && a.n_tasks == b.n_tasks;
+}
+
+bool save_shard(const std::string &path, const ShardState &st) {
+    std::string tmp_path = path + ".tmp";
+    {
+        std::ofstream out(tmp_path);
+        if (!out) return false;
+        out << SHARD_MAGIC << " " << SHARD_VERSION << "\n"
+            << "variant " << st.variant << "\n"
+            << "slots " << st.left_slots << " " << st.right_slots << "\n"
+            << "symmetry " << st.symmetry << "\n"
+            << "schedule " << st.schedule << "\n"
+            << "range " << st.cr_begin << " " << st.cr_end << "\n"
+            << "tasks " << st.next_task << " " << st.n_tasks << "\n"
+            << "counts";
+        for (int k = 0; k < n_depth; ++k) out << " " << st.counts[k];
+        out << "\n";
+        if (!out.flush()) { out.close(); std::remove(tmp_path.c_str()); return false; }
+    }
+    return replace_file(tmp_path, path);
+}
+
+bool load_shard(const std::string &path, ShardState &st) {
+    std::ifstream in(path);
+    if (!in) return false;
+    std::string magic, key[7];
+    int version = 0;
+    in >> magic >> version
+       >> key[5] >> st.variant
+       >> key[0] >> st.left_slots >> st.right_slots
+       >> key[1] >> st.symmetry
+       >> key[6] >> st.schedule
+       >> key[2] >> st.cr_begin >> st.cr_end
+       >> key[3] >> st.next_task >> st.n_tasks
+       >> key[4];
+    for (int k = 0; k < n_depth; ++k) in >> st.counts[k];
+    return in && magic == SHARD_MAGIC && version == SHARD_VERSION && key[0] == "slots" && key[1] == "symmetry" &&
+           key[2] == "range" && key[3] == "tasks" && key[4] == "counts" && key[5] == "variant" && key[6] == "schedule" &&
+           0 <= st.next_task && st.next_task <= st.n_tasks && 0 <= st.cr_begin && st.cr_begin <= st.cr_end && st.cr_end <= sz_cr;
+}
+
+// Sum finished shards into total_counts. The shards must share one configuration and their
+// ranges must tile [0, sz_cr) exactly.
+bool merge_shards(const std::vector<std::string> &files, long long* total_counts) {
+    std::vector<ShardState> shards(files.size());
+    for (size_t i = 0; i < files.size(); ++i) {
+        if (!load_shard(files[i], shards[i])) {
+            std::cerr << "[Error] Cannot read shard file " << files[i] << std::endl;
+            return false;
+        }
+        const ShardState &s = shards[i];
+        if (s.next_task != s.n_tasks) {
+            std::cerr << "[Error] Shard " << files[i] << " is incomplete (" << s.next_task << "/" << s.n_tasks << " tasks)" << std::endl;
+            return false;
+        }
+        // Symmetry classes are owned by the shard holding their smallest member, so shards
+        // with and without the reduction do not tile the state space
+        if (s.variant != shards[0].variant || s.left_slots != shards[0].left_slots || s.right_slots != shards[0].right_slots || 
+            s.symmetry != shards[0].symmetry) {
+            std::cerr << "[Error] Shard " << files[i] << " uses a different variant / slot / symmetry configuration" << std::endl;
+            return false;
+        }
+        std::cout << "[Merge] " << files[i] << ": cross [" << s.cr_begin << ", " << s.cr_end << ")" << std::endl;
+    }
+    
+    std::vector<std::pair<int, int>> ranges;
+    for (const auto &s : shards) ranges.push_back({s.cr_begin, s.cr_end});
+    std::sort(ranges.begin(), ranges.end());
+    int covered = 0;
+    for (const auto &r : ranges) {
+        if (r.first != covered) {
+            std::cerr << "[Error] Shards " << (r.first < covered ? "overlap" : "leave a gap") << " at cross " 
+                      << std::min(r.first, covered) << std::endl;
+            return false;
+        }
+        covered = r.second;
+    }
+    if (covered != sz_cr) {
+        std::cerr << "[Error] Shards leave a gap at cross " << covered << std::endl;
+        return false;
+    }
+    
+    for (const auto &s : shards) {
+        for (int k = 0; k < n_depth; ++k) total_counts[k] += s.counts[k];
+    }
+    return true;
+}
+
+// Print the exact distribution from the cumulative >= k counts
+void print_distribution(const long long* ge_counts) {
+    long long total_counts[20] = {0};
+    for(int k = 0; k < n_depth; ++k) total_counts[k] = ge_counts[k];
+    
+    std::cout << "\n=== Final Distribution ===" << std::endl;
+    long long grand_total = 0;
+    std::cout.imbue(std::locale(""));
+    
+    long long exact_counts[20] = {0};
+    for(int d = 0; d < 15; ++d) {
+        exact_counts[d] = total_counts[d] - total_counts[d + 1];
+    }
+    
+    for(int d = 0; d < 15; ++d) {
+        if(exact_counts[d] > 0) {
+            std::cout << d << "\t" << exact_counts[d] << std::endl;
+            grand_total += exact_counts[d];
+        }
+    }
+    std::cout << "total\t" << grand_total << std::endl;
+}
+
+// Write the joint histograms as exact counts, one row per (tensor, given value) and one column
+// per final depth: "cross" rows are given the cross distance, slot rows the xcross distance of
+// that slot. Each tensor's rows sum to the final distribution.
+bool write_joint_csv(const std::string &path, const JointCounts &joint, int slot_mask) {
+    std::ofstream out(path);
+    if (!out) {
+        std::cerr << "[Error] Cannot write " << path << std::endl;
+        return false;
+    }
+    // ge(a, k) with zero past the last depth
+    auto exact = [](auto ge, int a, int k) {
+        return ge(a, k) - ge(a + 1, k) - ge(a, k + 1) + ge(a + 1, k + 1);
+    };
+    out << "tensor,given";
+    for (int k = 0; k < n_depth; ++k) out << "," << k;
+    out << "\n";
+    for (int c = 0; c < n_depth; ++c) {
+        out << "cross," << c;
+        for (int k = 0; k < n_depth; ++k) {
+            out << "," << joint.cross[c][k] - (k + 1 < n_depth ? joint.cross[c][k + 1] : 0);
+        }
+        out << "\n";
+    }
+    static const char* slot_names[4] = {"BL", "BR", "FR", "FL"};
+    for (int sl = 0; sl < 4; ++sl) {
+        if (!((slot_mask >> sl) & 1)) continue;
+        auto ge = [&](int a, int k) { return a < n_depth && k < n_depth ? joint.slot[sl][a][k] : 0LL; };
+        for (int a = 0; a < n_depth; ++a) {
+            out << slot_names[sl] << "," << a;
+            for (int k = 0; k < n_depth; ++k) out << "," << exact(ge, a, k);
+            out << "\n";
+        }
+    }
+    return (bool)out;
+}
+
+// =========================================================================================
+// PART 7: Benchmarks
+// =========================================================================================
+// --bench times every pipeline phase separately, repeated over several runs and thread
+// counts, and writes median / mean / variance per (phase, threads) as CSV or JSON.
+// Aggregation phases run interleaved per cross state, so their times are the per-thread
+// time spent in each step averaged over the threads; "aggregate" is the wall time.
+
+struct BenchSeries {
+    std::string phase;
+    int threads;
+    std::vector<double> samples;
+};
+
+double bench_seconds(std::chrono::steady_clock::time_point start) {
+    return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+}
+
+// Time steps 1-2, 3 and 4 over all cross tasks: phase_seconds = {histogram, mitm_tables, join, aggregate}
+template<int LeftSlots, int RightSlots>
+void time_aggregator_phases(double* phase_seconds) {
+    double hist_s = 0, side_s = 0, join_s = 0;
+    int threads = 1;
+    auto wall_start = std::chrono::steady_clock::now();
+    #pragma omp parallel reduction(+:hist_s, side_s, join_s)
+    {
+        #pragma omp single
+        threads = omp_get_num_threads();
+        Aggregator<LeftSlots, RightSlots, n_depth>* agg = new Aggregator<LeftSlots, RightSlots, n_depth>();
+        long long counts[n_depth] = {0};
+        int last_task = -2;
+        #pragma omp for schedule(dynamic, 100)
+        for (int t = 0; t < (int)cross_tasks.size(); ++t) {
+            auto t0 = std::chrono::steady_clock::now();
+            bool mirrored = cross_task_mirrors[t] && last_task == t - 1;
+            last_task = t;
+            if (t + 1 < (int)cross_tasks.size() && !cross_task_mirrors[t + 1]) agg->prefetch(cross_tasks[t + 1]);
+            if (mirrored) agg->build_histograms_mirrored(cross_tasks[t]);
+            else agg->build_histograms(cross_tasks[t]);
+            auto t1 = std::chrono::steady_clock::now();
+            agg->build_sides();
+            auto t2 = std::chrono::steady_clock::now();
+            agg->join_disjoint(counts);
+            auto t3 = std::chrono::steady_clock::now();
+            hist_s += std::chrono::duration<double>(t1 - t0).count();
+            side_s += std::chrono::duration<double>(t2 - t1).count();
+            join_s += std::chrono::duration<double>(t3 - t2).count();
+        }
+        delete agg;
+    }
+    phase_seconds[3] = bench_seconds(wall_start);
+    phase_seconds[0] = hist_s / threads;
+    phase_seconds[1] = side_s / threads;
+    phase_seconds[2] = join_s / threads;
+}
+
+void run_benchmarks(const std::vector<int> &thread_counts, int repeats, const std::string &out_path, 
+                    int left_slots, int right_slots) {
+    std::vector<BenchSeries> series;
+    auto record = [&](const std::string &phase, int threads, double seconds) {
+        for (auto &s : series) {
+            if (s.phase == phase && s.threads == threads) { s.samples.push_back(seconds); return; }
+        }
+        series.push_back({phase, threads, {seconds}});
+    };
+    
+    for (int threads : thread_counts) {
+        omp_set_num_threads(threads);
+        for (int rep = 0; rep < repeats; ++rep) {
+            std::cout << "[Bench] threads=" << threads << " run " << (rep + 1) << "/" << repeats << std::endl;
+            auto t = std::chrono::steady_clock::now();
+            auto mt_edge = create_edge_move_table();
+            auto mt_corn = create_corner_move_table();
+            auto mt_multi = create_multi_move_table(4, 2, 12, sz_cr, mt_edge);
+            record("move_tables", threads, bench_seconds(t));
+            
+            NibbleTable bench_table;
+            t = std::chrono::steady_clock::now();
+            generate_table(bench_table, 187520, 12, 0, mt_multi, mt_corn, mt_edge, "BL Table");
+            record("bfs_bl", threads, bench_seconds(t));
+            t = std::chrono::steady_clock::now();
+            generate_table(bench_table, 187520, 15, 2, mt_multi, mt_corn, mt_edge, "BR Table");
+            record("bfs_br", threads, bench_seconds(t));
+            
+            t = std::chrono::steady_clock::now();
+            precompute_cross_y2();
+            record("cross_y2", threads, bench_seconds(t));
+            
+            double phase_seconds[4];
+            switch (left_slots * 10 + right_slots) {
+                case 10: time_aggregator_phases<1, 0>(phase_seconds); break;
+                case 20: time_aggregator_phases<2, 0>(phase_seconds); break;
+                case 11: time_aggregator_phases<1, 1>(phase_seconds); break;
+                case 21: time_aggregator_phases<2, 1>(phase_seconds); break;
+                default: time_aggregator_phases<2, 2>(phase_seconds); break;
+            }
+            record("histogram", threads, phase_seconds[0]);
+            record("mitm_tables", threads, phase_seconds[1]);
+            record("join", threads, phase_seconds[2]);
+            record("aggregate", threads, phase_seconds[3]);
+        }
+    }
+    
+    bool json = out_path.size() >= 5 && out_path.compare(out_path.size() - 5, 5, ".json") == 0;
+    std::ofstream out(out_path);
+    if (json) out << "[\n";
+    else out << "phase,threads,repeats,median_s,mean_s,variance,min_s,max_s\n";
+    out << std::setprecision(6);
+    
+    std::cout << "\n=== Benchmark (" << repeats << " runs) ===" << std::endl;
+    std::cout << std::left << std::setw(14) << "phase" << std::right << std::setw(8) << "threads" 
+              << std::setw(12) << "median_s" << std::setw(12) << "stddev_s" << std::endl;
+    for (size_t i = 0; i < series.size(); ++i) {
+        std::vector<double> v = series[i].samples;
+        std::sort(v.begin(), v.end());
+        size_t n = v.size();
+        double median = (n % 2) ? v[n / 2] : 0.5 * (v[n / 2 - 1] + v[n / 2]);
+        double mean = 0, var = 0;
+        for (double x : v) mean += x;
+        mean /= n;
+        for (double x : v) var += (x - mean) * (x - mean);
+        var = n > 1 ? var / (n - 1) : 0.0;
+        
+        if (json) {
+            out << "  {\"phase\": \"" << series[i].phase << "\", \"threads\": " << series[i].threads 
+                << ", \"repeats\": " << n << ", \"median_s\": " << median << ", \"mean_s\": " << mean 
+                << ", \"variance\": " << var << ", \"min_s\": " << v.front() << ", \"max_s\": " << v.back() << "}"
+                << (i + 1 < series.size() ? ",\n" : "\n");
+        } else {
+            out << series[i].phase << "," << series[i].threads << "," << n << "," << median << "," << mean 
+                << "," << var << "," << v.front() << "," << v.back() << "\n";
+        }
+        std::cout << std::left << std::setw(14) << series[i].phase << std::right << std::setw(8) << series[i].threads 
+                  << std::fixed << std::setprecision(4) << std::setw(12) << median << std::setw(12) << std::sqrt(var) << std::endl;
+    }
+    if (json) out << "]\n";
+    std::cout << "[Bench] Results written to " << out_path << std::endl;
+}
+
+// =========================================================================================
+// PART 8: Solver Daemon (Unix Domain Socket)
+// =========================================================================================
+// --serve PATH keeps the tables resident and answers batches of "id,scramble" lines sent over
+// a Unix socket. A batch ends with an empty line (or EOF); the reply is one "id,<90 values>"
+// row per request line, in request order and streamed as rows complete, followed by an empty
+// line. A line without a comma gets the row "#<line number in the batch>" with empty fields,
+// like an unparsable scramble, so rows stay aligned with the request. Lines of all connections go through one FIFO queue served by a fixed pool of solver
+// threads. --query PATH [FILE] is a minimal client for scripts.
+
+// One batch of requests from a connection; rows are filled in by the pool
+struct SolveBatch {
+    std::vector<std::string> ids, scrambles;
+    std::vector<int> results;
+    std::vector<char> state; // 0 = pending, 1 = solved, 2 = unparsable, 3 = taken from the result store
+    std::mutex mtx;
+    std::condition_variable cv;
+};
+
+template<typename Variant>
+class SolverPool {
+public:
+    SolverPool(int threads, const std::vector<int> &multi, const std::vector<int> &corn, const std::vector<int> &edge) {
+        for (int i = 0; i < threads; ++i) {
+            workers.emplace_back([this, &multi, &corn, &edge] { work(multi, corn, edge); });
+        }
+    }
+
+    ~SolverPool() {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            stopping = true;
+        }
+        cv.notify_all();
+        for (auto &w : workers) w.join();
+    }
+
+    void submit(SolveBatch &batch) {
+        {
+            std::lock_guard<std::mutex> lock(mtx);
+            for (size_t i = 0; i < batch.ids.size(); ++i) {
+                if (batch.state[i] == 0) queue.push_back({&batch, i});
+            }
+        }
+        cv.notify_all();
+    }
+
+private:
+    void work(const std::vector<int> &multi, const std::vector<int> &corn, const std::vector<int> &edge) {
+        ScrambleSolver<Variant> solver(multi, corn, edge);
+        std::vector<int> moves;
+        while (true) {
+            std::pair<SolveBatch*, size_t> job;
+            {
+                std::unique_lock<std::mutex> lock(mtx);
+                cv.wait(lock, [this] { return stopping || !queue.empty(); });
+                if (queue.empty()) return;
+                job = queue.front();
+                queue.pop_front();
+            }
+            SolveBatch &b = *job.first;
+            size_t i = job.second;
+            bool ok = parse_scramble(b.scrambles[i], moves);
+            if (ok) solver.solve_scramble(moves, &b.results[i * num_results]);
+            {
+                std::lock_guard<std::mutex> lock(b.mtx);
+                b.state[i] = ok ? 1 : 2;
+            }
+            b.cv.notify_all();
+        }
+    }
+
+    std::vector<std::thread> workers;
+    std::deque<std::pair<SolveBatch*, size_t>> queue;
+    std::mutex mtx;
+    std::condition_variable cv;
+    bool stopping = false;
+};
+
+#ifndef _WIN32
+// Buffered line reader over a socket; returns false at EOF with no pending data
+class SocketLineReader {
+public:
+    explicit SocketLineReader(int fd) : fd(fd) {}
+
+    bool read_line(std::string &line) {
+        line.clear();
+        while (true) {
+            size_t nl = buf.find('\n', pos);
+            if (nl != std::string::npos) {
+                line.assign(buf, pos, nl - pos);
+                pos = nl + 1;
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                return true;
+            }
+            buf.erase(0, pos);
+            pos = 0;
+            char chunk[65536];
+            ssize_t got = read(fd, chunk, sizeof(chunk));
+            if (got <= 0) {
+                if (buf.empty()) return false;
+                line.swap(buf);
+                buf.clear();
+                if (!line.empty() && line.back() == '\r') line.pop_back();
+                return true;
+            }
+            buf.append(chunk, (size_t)got);
+        }
+    }
+
+private:
+    int fd;
+    std::string buf;
+    size_t pos = 0;
+};
+
+bool write_all(int fd, const std::string &data) {
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = write(fd, data.data() + done, data.size() - done);
+        if (n <= 0) return false;
+        done += (size_t)n;
+    }
+    return true;
+}
+
+template<typename Variant>
+void serve_connection(int fd, SolverPool<Variant> &pool) {
+    SocketLineReader reader(fd);
+    bool eof = false, connected = true;
+    while (!eof && connected) {
+        SolveBatch batch;
+        std::string line;
+        while (true) {
+            if (!reader.read_line(line)) { eof = true; break; }
+            if (line.empty()) break;
+            size_t comma = line.find(',');
+            if (comma == std::string::npos) {
+                batch.ids.push_back("#" + std::to_string(batch.ids.size() + 1));
+                batch.scrambles.push_back("");
+                batch.state.push_back(2);
+                continue;
+            }
+            batch.ids.push_back(line.substr(0, comma));
+            batch.scrambles.push_back(line.substr(comma + 1));
+            batch.state.push_back(0);
+        }
+        if (batch.ids.empty()) {
+            if (!eof) connected = write_all(fd, "\n");
+            continue;
+        }
+        size_t n = batch.ids.size();
+        batch.results.assign(n * num_results, -1);
+        pool.submit(batch);
+        
+        // Stream rows in request order. After a write error keep waiting: the pool still
+        // references the batch until every row is done.
+        std::string out;
+        for (size_t i = 0; i < n; ++i) {
+            {
+                std::unique_lock<std::mutex> lock(batch.mtx);
+                batch.cv.wait(lock, [&] { return batch.state[i] != 0; });
+            }
+            append_result_row(out, batch.ids[i], &batch.results[i * num_results], batch.state[i] == 1);
+            bool more_ready;
+            {
+                std::lock_guard<std::mutex> lock(batch.mtx);
+                more_ready = i + 1 < n && batch.state[i + 1] != 0;
+            }
+            if (!more_ready) {
+                if (connected) connected = write_all(fd, out);
+                out.clear();
+            }
+        }
+        if (connected) connected = write_all(fd, "\n");
+    }
+    close(fd);
+}
+
+std::string serve_socket_path;
+
+void serve_shutdown(int) {
+    unlink(serve_socket_path.c_str());
+    _exit(0);
+}
+
+template<typename Variant>
+int run_server(const std::string &path, int threads, 
+    const std::vector<int> &mt_multi, const std::vector<int> &mt_corn, const std::vector<int> &mt_edge) 
+{
+    int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    if (listen_fd < 0 || path.size() >= sizeof(addr.sun_path)) {
+        std::cerr << "[Error] Cannot create socket " << path << std::endl;
+        return 1;
+    }
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    unlink(path.c_str());
+    if (bind(listen_fd, (sockaddr*)&addr, sizeof(addr)) != 0 || listen(listen_fd, 64) != 0) {
+        std::cerr << "[Error] Cannot listen on " << path << ": " << std::strerror(errno) << std::endl;
+        close(listen_fd);
+        return 1;
+    }
+    serve_socket_path = path;
+    std::signal(SIGPIPE, SIG_IGN);
+    std::signal(SIGINT, serve_shutdown);
+    std::signal(SIGTERM, serve_shutdown);
+    
+    SolverPool<Variant> pool(threads, mt_multi, mt_corn, mt_edge);
+    std::cout << "[Serve] Listening on " << path << " with " << threads << " solver threads" << std::endl;
+    while (true) {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0) {
+            if (errno == EINTR) continue;
+            std::cerr << "[Error] accept: " << std::strerror(errno) << std::endl;
+            break;
+        }
+        std::thread(serve_connection<Variant>, fd, std::ref(pool)).detach();
+    }
+    close(listen_fd);
+    unlink(path.c_str());
+    return 1;
+}
+
+// Send one batch (the lines of 'in_path', or stdin) and copy the reply rows to stdout
+int run_query(const std::string &path, const std::string &in_path) {
+    int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    sockaddr_un addr;
+    std::memset(&addr, 0, sizeof(addr));
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (fd < 0 || connect(fd, (sockaddr*)&addr, sizeof(addr)) != 0) {
+        std::cerr << "[Error] Cannot connect to " << path << std::endl;
+        return 1;
+    }
+    std::ifstream file;
+    if (!in_path.empty()) file.open(in_path);
+    std::istream &in = in_path.empty() ? std::cin : file;
+    std::string line, request;
+    while (std::getline(in, line)) {
+        if (!line.empty() && line.back() == '\r') line.pop_back();
+        if (!line.empty()) request += line + "\n";
+    }
+    request += "\n";
+    std::signal(SIGPIPE, SIG_IGN);
+    if (!write_all(fd, request)) {
+        std::cerr << "[Error] Server closed the connection" << std::endl;
+        close(fd);
+        return 1;
+    }
+    SocketLineReader reader(fd);
+    while (reader.read_line(line) && !line.empty()) std::cout << line << '\n';
+    close(fd);
+    return 0;
+}
+#else
+template<typename Variant>
+int run_server(const std::string &, int, const std::vector<int> &, const std::vector<int> &, const std::vector<int> &) {
+    std::cerr << "[Error] --serve needs Unix domain sockets (not available in this build)" << std::endl;
+    return 1;
+}
+
+int run_query(const std::string &, const std::string &) {
+    std::cerr << "[Error] --query needs Unix domain sockets (not available in this build)" << std::endl;
+    return 1;
+}
+#endif
+
+// =========================================================================================
+// PART 9: Streaming WCA Export Pipeline
+// =========================================================================================
+// --stream IN OUT solves the WCA scramble export (wca_scrambles_info.csv) in one pass and writes
+// the cross_table.sql import file directly, replacing the split / merge steps of
+// wca_scramble_processor.py and wca_scramble_cross_processor.py. A reader thread parses the CSV
+// from a large buffer, applies the same id / multi-blind / wide-move rules, and hands batches of
+// rows to the solver pool through a bounded queue; the main thread writes batches back in input
+// order. At most a fixed number of batches is in flight, so memory does not grow with the input.
+
+const int stream_batch_rows = 256;
+const char* stream_base_columns[] = {"id", "scramble", "competition_id", "event_id", "round_type_id", "group_id", "is_extra", "scramble_num"};
+const int n_stream_base = 8;
+
+// Buffered CSV reader; quoted fields may contain separators, doubled quotes and line breaks
+class CsvReader {
+public:
+    explicit CsvReader(const std::string &path) : in(path, std::ios::binary), buf(1 << 20) {}
+
+    bool is_open() const { return in.is_open(); }
+
+    // Next record, false at end of input
+    bool next(std::vector<std::string> &fields) {
+        fields.clear();
+        if(!fill()) return false;
+        std::string field;
+        bool quoted = false;
+        while(fill()) {
+            char c = buf[pos++];
+            if(quoted) {
+                if(c != '"') field += c;
+                else if(fill() && buf[pos] == '"') { field += '"'; ++pos; }
+                else quoted = false;
+            } else if(c == '"') {
+                quoted = true;
+            } else if(c == ',') {
+                fields.push_back(field);
+                field.clear();
+            } else if(c == '\n') {
+                if(!field.empty() && field.back() == '\r') field.pop_back();
+                break;
+            } else {
+                field += c;
+            }
+        }
+        fields.push_back(field);
+        return true;
+    }
+
+private:
+    bool fill() {
+        if(pos < len) return true;
+        in.read(buf.data(), buf.size());
+        len = (size_t)in.gcount();
+        pos = 0;
+        return len > 0;
+    }
+
+    std::ifstream in;
+    std::vector<char> buf;
+    size_t pos = 0, len = 0;
+};
+
+// Append a field, quoted only when it has to be (as pandas' to_csv does)
+void append_csv_field(std::string &out, const std::string &field) {
+    if(field.find_first_of(",\"\r\n") == std::string::npos) { out += field; return; }
+    out += '"';
+    for(char c : field) {
+        if(c == '"') out += '"';
+        out += c;
+    }
+    out += '"';
+}
+
+std::string trim(const std::string &s) {
+    size_t b = s.find_first_not_of(" \t\r\n"), e = s.find_last_not_of(" \t\r\n");
+    return b == std::string::npos ? "" : s.substr(b, e - b + 1);
+}
+
+// Replace wide moves (Rw, Uw2, ...) by the opposite face turn and carry the implied whole-cube
+// rotation over to the following moves (fix_scramble() of wca_scramble_processor.py)
+std::string fix_scramble(const std::string &scramble) {
+    static const char faces[] = "UFRDBL";
+    static const int perm_x[6] = {1, 3, 2, 4, 0, 5}, perm_y[6] = {0, 2, 4, 3, 5, 1}, perm_z[6] = {5, 1, 0, 2, 4, 3};
+    int p[6] = {0, 1, 2, 3, 4, 5};
+    std::string result;
+    size_t n = scramble.size();
+    for(size_t i = 0; i < n; ++i) {
+        char base = scramble[i];
+        if(!base || !std::strchr("RULDFB", base)) continue;
+        bool wide = i + 1 < n && scramble[i + 1] == 'w';
+        if(wide) ++i;
+        char suffix = (i + 1 < n && (scramble[i + 1] == '2' || scramble[i + 1] == '\'')) ? scramble[++i] : 0;
+        int k = suffix == '2' ? 2 : (suffix == '\'' ? 3 : 1);
+        int phys = std::strchr(faces, base) - faces;
+        
+        if(!result.empty()) result += ' ';
+        result += faces[p[wide ? (phys + 3) % 6 : phys]];
+        if(suffix) result += suffix;
+        if(wide) {
+            const int* perm = (base == 'R' || base == 'L') ? perm_x : ((base == 'U' || base == 'D') ? perm_y : perm_z);
+            int turns = (k * (std::strchr("RUF", base) ? 1 : 3)) % 4;
+            for(int t = 0; t < turns; ++t) {
+                int q[6];
+                for(int j = 0; j < 6; ++j) q[j] = p[perm[j]];
+                std::copy(q, q + 6, p);
+            }
+        }
+    }
+    return result;
+}
+
+// Column names of the 90 results, e.g. Y_C, Y_BL, ..., B_BR_FR_FL
+// "BL_BR" for a slot mask, "C" for the cross alone
+std::string slot_mask_name(int mask) {
+    static const char* slots[4] = {"BL", "BR", "FR", "FL"};
+    if(!mask) return "C";
+    std::string name;
+    for(int s = 0; s < 4; ++s) {
+        if((mask >> s) & 1) name = name + (name.empty() ? "" : "_") + slots[s];
+    }
+    return name;
+}
+
+std::string result_column_name(int k) {
+    static const char* colors[num_colors] = {"Y", "W", "O", "R", "G", "B"};
+    return std::string(colors[k / num_targets]) + "_" + slot_mask_name(target_masks[k % num_targets]);
+}
+
+template<typename T>
+class BoundedQueue {
+public:
+    explicit BoundedQueue(size_t capacity) : capacity(capacity) {}
+
+    void push(T item) {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_full.wait(lock, [this] { return items.size() < capacity; });
+        items.push_back(std::move(item));
+        not_empty.notify_one();
+    }
+
+    // False once the queue is closed and drained
+    bool pop(T &item) {
+        std::unique_lock<std::mutex> lock(mtx);
+        not_empty.wait(lock, [this] { return closed || !items.empty(); });
+        if(items.empty()) return false;
+        item = std::move(items.front());
+        items.pop_front();
+        not_full.notify_one();
+        return true;
+    }
+
+    void close() {
+        std::lock_guard<std::mutex> lock(mtx);
+        closed = true;
+        not_empty.notify_all();
+    }
+
+private:
+    size_t capacity;
+    std::deque<T> items;
+    std::mutex mtx;
+    std::condition_variable not_full, not_empty;
+    bool closed = false;
+};
+
+template<typename Variant>
+bool run_stream(const std::string &in_path, const std::string &out_path, int threads, 
+    const std::vector<int> &mt_multi, const std::vector<int> &mt_corn, const std::vector<int> &mt_edge, ResultStore* store) 
+{
+    CsvReader reader(in_path);
+    std::vector<std::string> header;
+    if(!reader.is_open() || !reader.next(header)) {
+        std::cerr << "[Error] Cannot read " << in_path << std::endl;
+        return false;
+    }
+    if(!header.empty() && header[0].compare(0, 3, "\xEF\xBB\xBF") == 0) header[0].erase(0, 3); // UTF-8 BOM
+    int col[n_stream_base];
+    for(int c = 0; c < n_stream_base; ++c) {
+        col[c] = std::find(header.begin(), header.end(), stream_base_columns[c]) - header.begin();
+        if(col[c] == (int)header.size()) {
+            std::cerr << "[Error] " << in_path << " has no column " << stream_base_columns[c] << std::endl;
+            return false;
+        }
+    }
+    
+    std::ofstream out(out_path, std::ios::binary);
+    if(!out) {
+        std::cerr << "[Error] Cannot write " << out_path << std::endl;
+        return false;
+    }
+    // cross_table.sql column order; LOAD DATA expects '\r\n' line ends and skips the header
+    std::string text;
+    for(int c = 0; c < n_stream_base; ++c) text += std::string(c ? "," : "") + stream_base_columns[c];
+    for(int k = 0; k < num_results; ++k) text += "," + result_column_name(k);
+    text += "\r\n";
+    out << text;
+    
+    std::cout << "[Stream] " << in_path << " -> " << out_path << " (" << threads << " solver threads)..." << std::endl;
+    auto t_start = std::chrono::high_resolution_clock::now();
+    
+    SolverPool<Variant> pool(threads, mt_multi, mt_corn, mt_edge);
+    BoundedQueue<std::unique_ptr<SolveBatch>> pending(4 * threads);
+    long long n_records = 0, n_short = 0;
+    
+    // Reader: one output row per scramble, its leading columns kept as the batch 'id'. Rows
+    // found in the result store are filled in right away and never reach the pool.
+    std::thread producer([&] {
+        std::vector<std::string> f;
+        std::unique_ptr<SolveBatch> batch(new SolveBatch);
+        auto add_row = [&](const std::string &id, const std::string &scramble) {
+            std::string prefix;
+            for(int c = 0; c < n_stream_base; ++c) {
+                if(c) prefix += ',';
+                append_csv_field(prefix, c == 0 ? id : (c == 1 ? scramble : f[col[c]]));
+            }
+            batch->ids.push_back(prefix);
+            batch->scrambles.push_back(fix_scramble(scramble));
+            batch->results.resize(batch->results.size() + num_results, -1);
+            uint64_t key;
+            bool stored = store && parse_store_key(id, key) && store->find(key, &batch->results[batch->results.size() - num_results]);
+            batch->state.push_back(stored ? 3 : 0);
+        };
+        auto submit = [&] {
+            if(batch->ids.empty()) return;
+            pool.submit(*batch);
+            pending.push(std::move(batch));
+            batch.reset(new SolveBatch);
+        };
+        
+        while(reader.next(f)) {
+            if(f.size() == 1 && f[0].empty()) continue;
+            if(f.size() < header.size()) { n_short++; continue; }
+            n_records++;
+            const std::string &id = f[col[0]], &scramble = f[col[1]];
+            if(f[col[3]] == "333mbf") {
+                // One row per cube: id without its "_n" suffix + 3-digit cube number
+                std::string base = id.substr(0, id.find('_')), all = trim(scramble);
+                int sub = 0;
+                for(size_t b = 0; b <= all.size(); ) {
+                    size_t e = all.find('\n', b);
+                    if(e == std::string::npos) e = all.size();
+                    std::string num = std::to_string(++sub);
+                    add_row(base + std::string(num.size() < 3 ? 3 - num.size() : 0, '0') + num, trim(all.substr(b, e - b)));
+                    b = e + 1;
+                }
+            } else {
+                add_row(id + "001", scramble);
+            }
+            if((int)batch->ids.size() >= stream_batch_rows) submit();
+        }
+        submit();
+        pending.close();
+    });
+    
+    long long n_rows = 0, n_invalid = 0, n_stored = 0;
+    std::unique_ptr<SolveBatch> batch;
+    while(pending.pop(batch)) {
+        text.clear();
+        for(size_t i = 0; i < batch->ids.size(); ++i) {
+            {
+                std::unique_lock<std::mutex> lock(batch->mtx);
+                batch->cv.wait(lock, [&] { return batch->state[i] != 0; });
+            }
+            char st = batch->state[i];
+            append_result_row(text, batch->ids[i], &batch->results[i * num_results], st == 1 || st == 3, "\r\n");
+            n_invalid += st == 2;
+            n_stored += st == 3;
+            uint64_t key;
+            if(store && st == 1 && parse_store_key(batch->ids[i], key)) store->append(key, &batch->results[i * num_results]);
+        }
+        out << text;
+        if(store && !store->flush()) std::cerr << "[Warning] Could not append to the result store" << std::endl;
+        n_rows += batch->ids.size();
+    }
+    producer.join();
+    out.close();
+    
+    std::chrono::duration<double> t_el = std::chrono::high_resolution_clock::now() - t_start;
+    std::cout << "[Stream] Done. (" << n_records << " records, " << n_rows << " rows";
+    if(store) std::cout << ", " << n_stored << " from the result store";
+    std::cout << ", Time: " << std::fixed << std::setprecision(2) 
+              << t_el.count() << "s, " << (int)(n_rows / std::max(t_el.count(), 1e-9)) << " rows/s)" << std::endl;
+    if(n_short) std::cerr << "[Warning] Skipped " << n_short << " records with missing columns" << std::endl;
+    if(n_invalid) std::cerr << "[Warning] " << n_invalid << " unparsable scrambles (empty result columns)" << std::endl;
+    return (bool)out;
+}
+
+// =========================================================================================
+// PART 10: Monte Carlo Sampling
+// =========================================================================================
+// --sample estimates the distribution of a target too large to enumerate (e.g. xxxxcross)
+// from uniformly random cube states solved with the IDA* solver. Sample i is drawn from its
+// own generator seeded by (seed, i), so a run is reproducible for any thread count. Batches
+// are sized to take about a second; after each one the estimate is reported with 95% Wilson
+// intervals, until the sample count, the precision or the time budget is reached.
+
+// SplitMix64, seeded per sample
+struct SampleRng {
+    uint64_t x;
+    explicit SampleRng(uint64_t seed) : x(seed) {}
+    uint64_t next() {
+        uint64_t z = (x += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+    int below(int n) { return (int)(next() % n); }
+};
+
+// Solver coordinates of a uniformly random cube state: random positions for all 12 edges and
+// 8 corners, random twists and flips. The permutation parity and corner twist constraints
+// never bind on the tracked pieces; the flip parity does for the EO coordinate.
+SolverCoord random_coord(SampleRng &rng) {
+    int edge_pos[12], corner_pos[8], flip[12], flips = 0; // flip[i]: edge at position i
+    for(int i = 0; i < 12; ++i) edge_pos[i] = i;
+    for(int i = 0; i < 8; ++i) corner_pos[i] = i;
+    for(int i = 11; i > 0; --i) std::swap(edge_pos[i], edge_pos[rng.below(i + 1)]);
+    for(int i = 7; i > 0; --i) std::swap(corner_pos[i], corner_pos[rng.below(i + 1)]);
+    for(int i = 0; i < 11; ++i) flips ^= (flip[i] = rng.below(2));
+    flip[11] = flips;
+
+    SolverCoord c;
+    int p_cross[4];
+    for(int k = 0; k < 4; ++k) p_cross[k] = 2 * edge_pos[8 + k] + flip[edge_pos[8 + k]];
+    c.cr = array_to_index(p_cross, 4, 2, 12);
+    for(int s = 0; s < 4; ++s) {
+        c.cn[s] = 3 * corner_pos[4 + s] + rng.below(3);
+        c.ed[s] = 2 * edge_pos[s] + flip[edge_pos[s]];
+    }
+    c.eo = 0;
+    for(int i = 0; i < 11; ++i) c.eo |= flip[i] << i;
+    return c;
+}
+
+// 95% Wilson score interval of a proportion x / n
+void wilson_interval(long long x, long long n, double &lo, double &hi) {
+    const double z = 1.96;
+    double p = (double)x / n, z2n = z * z / n;
+    double center = (p + z2n / 2) / (1 + z2n);
+    double half = z / (1 + z2n) * std::sqrt(p * (1 - p) / n + z2n / (4.0 * n));
+    lo = std::max(0.0, center - half);
+    hi = std::min(1.0, center + half);
+}
+
+// Parse "BL,BR" / "BL_BR" (or "C" for the cross alone) into a slot mask; -1 when invalid
+int parse_slot_mask(const std::string &text) {
+    static const char* slots[4] = {"BL", "BR", "FR", "FL"};
+    if(text == "C") return 0;
+    int mask = 0;
+    for(size_t pos = 0; pos <= text.size(); ) {
+        size_t end = text.find_first_of(",_", pos);
+        if(end == std::string::npos) end = text.size();
+        std::string name = text.substr(pos, end - pos);
+        int s = 0;
+        while(s < 4 && name != slots[s]) ++s;
+        if(s == 4) return -1;
+        mask |= 1 << s;
+        pos = end + 1;
+    }
+    return mask;
+}
+
+// Default --time-budget in seconds. Each sample is one IDA* solve driven by the per-slot
+// xcross tables, so the cost grows steeply with the number of slots; on one core roughly
+// 3000 samples/s for xxcross, 45/s for xxxcross and 0.4/s for xxxxcross (about 7 hours for
+// +-1% there), which is why the budget also applies when only --samples / --precision is set.
+const double default_sample_budget = 600;
+
+struct SampleLimits {
+    long long samples = 0;    // Stop after this many samples (0: no limit)
+    double precision = 0;     // Stop once every 95% half-width is below this fraction (0: no limit)
+    double time_budget = -1;  // Stop after this many seconds (0: no limit, < 0: default_sample_budget)
+};
+
+// Estimate the distribution of the optimal cross + 'mask' length of the variant
+template<typename Variant>
+void run_sampler(int mask, const SampleLimits &limits, uint64_t seed, int threads,
+                 const std::vector<int> &mt_multi, const std::vector<int> &mt_corn, const std::vector<int> &mt_edge) {
+    std::cout << "[Sample] " << slot_mask_name(mask) << " (" << Variant::name()
+              << "), seed " << seed << ", " << threads << " threads" << std::endl;
+    // hist[max_solve_depth + 1]: no solution within max_solve_depth
+    std::vector<long long> hist(max_solve_depth + 2, 0);
+    long long n = 0, batch = threads;
+    double max_half = 1;
+    bool warned = false;
+    auto t_start = std::chrono::high_resolution_clock::now();
+    // The budget also cuts off solves in flight, so one slow batch cannot overrun it
+    auto deadline = limits.time_budget > 0
+        ? std::chrono::steady_clock::now() + std::chrono::duration_cast<std::chrono::steady_clock::duration>(std::chrono::duration<double>(limits.time_budget))
+        : std::chrono::steady_clock::time_point::max();
+    std::vector<int> lengths;
+
+    // One line per depth: count, estimate and interval
+    auto report = [&](bool final_report) {
+        std::ostringstream line;
+        line << std::fixed << std::setprecision(final_report ? 4 : 2);
+        max_half = 0;
+        for(int d = 0; d <= max_solve_depth + 1; ++d) {
+            double lo, hi;
+            wilson_interval(hist[d], n, lo, hi);
+            max_half = std::max(max_half, (hi - lo) / 2);
+            if(!hist[d]) continue;
+            std::string depth = d > max_solve_depth ? ">" + std::to_string(max_solve_depth) : std::to_string(d);
+            if(final_report) {
+                line << depth << "\t" << hist[d] << "\t" << 100.0 * hist[d] / n << "%\t[" << 100 * lo << "%, " << 100 * hi << "%]\n";
+            } else {
+                line << " " << depth << ":" << 100.0 * hist[d] / n << "%";
+            }
+        }
+        return line.str();
+    };
+
+    while(true) {
+        long long count = limits.samples > 0 ? std::min(batch, limits.samples - n) : batch;
+        lengths.assign(count, 0);
+        auto b_start = std::chrono::high_resolution_clock::now();
+        #pragma omp parallel num_threads(threads)
         {
-            for(int d = 0; d < 20; ++d) total_counts[d] += local_counts[d];
+            ScrambleSolver<Variant> solver(mt_multi, mt_corn, mt_edge);
+            solver.set_deadline(deadline);
+            #pragma omp for schedule(dynamic, 1)
+            for(long long i = 0; i < count; ++i) {
+                SampleRng rng(seed + (uint64_t)(n + i) * 0xD1B54A32D192ED03ULL);
+                lengths[i] = solver.solve(random_coord(rng), mask);
+                if(solver.timed_out()) lengths[i] = -2;
+            }
+        }
+        // Keep the samples before the first one cut off, so the set stays a prefix of the seed sequence
+        long long done = std::find(lengths.begin(), lengths.end(), -2) - lengths.begin();
+        for(long long i = 0; i < done; ++i) hist[lengths[i] < 0 ? max_solve_depth + 1 : lengths[i]]++;
+        n += done;
+        if(done < count) {
+            std::cout << "[Sample] Time budget reached during a solve; " << count - done << " unfinished samples dropped" << std::endl;
+            if(n == 0) {
+                std::cout << "[Sample] No sample finished within the " << std::setprecision(1) << limits.time_budget << "s time budget" << std::endl;
+                return;
+            }
+        }
+
+        auto now = std::chrono::high_resolution_clock::now();
+        double elapsed = std::chrono::duration<double>(now - t_start).count();
+        double b_elapsed = std::chrono::duration<double>(now - b_start).count();
+        std::string dist = report(false);
+        std::cout << "[Sample] " << n << " states, " << std::fixed << std::setprecision(1) << elapsed << "s, +-"
+                  << std::setprecision(3) << 100 * max_half << "% |" << dist << std::endl;
+
+        // Project the cost of the requested stop condition (normal approximation, worst-case
+        // p(1 - p) for small n) and, once the rate has settled, say so when the time budget
+        // will cut the run short
+        double rate = n / std::max(elapsed, 1e-9);
+        long long goal = limits.samples;
+        if(limits.precision > 0 && max_half > limits.precision) {
+            double var = n < 30 ? 0.25 : 0;
+            for(long long x : hist) var = std::max(var, (double)x / n * (1 - (double)x / n));
+            long long needed = (long long)std::ceil(1.96 * 1.96 * var / (limits.precision * limits.precision));
+            goal = goal > 0 ? std::min(goal, needed) : needed;
+        }
+        bool settled = elapsed >= 5 || n >= 100;
+        if(!warned && settled && goal > n && limits.time_budget > 0 && goal / rate > limits.time_budget) {
+            std::cout << "[Sample] At " << std::setprecision(1) << rate << " samples/s, " << goal << " samples would take about "
+                      << (long long)(goal / rate) << "s; stopping at the " << limits.time_budget << "s time budget" << std::endl;
+            warned = true;
+        }
+
+        if(limits.samples > 0 && n >= limits.samples) break;
+        if(limits.precision > 0 && max_half <= limits.precision) break;
+        if(done < count || (limits.time_budget > 0 && elapsed >= limits.time_budget)) break;
+        // Aim for one second per batch, without running far past the time budget
+        double per_sample = b_elapsed / count, target = 1.0;
+        if(limits.time_budget > 0) target = std::min(target, std::max(limits.time_budget - elapsed, per_sample));
+        batch = std::max<long long>(threads, std::min<long long>(4 * batch, (long long)(target / std::max(per_sample, 1e-9))));
+    }
+
+    std::chrono::duration<double> el = std::chrono::high_resolution_clock::now() - t_start;
+    std::cout << "\n=== Estimated Distribution (" << n << " samples, " << std::fixed << std::setprecision(1) << el.count()
+              << "s, " << n / std::max(el.count(), 1e-9) << " samples/s) ===" << std::endl;
+    std::cout << "depth\tcount\testimate\t95% interval" << std::endl;
+    std::cout << report(true);
+    std::cout << std::setprecision(4) << "max half-width\t" << 100 * max_half << "%" << std::endl;
+}
+
+// =========================================================================================
+// MAIN
+// =========================================================================================
+
+int main(int argc, char* argv[]) {
+    auto global_start = std::chrono::high_resolution_clock::now();
+
+    // Command line options
+    std::vector<std::string> solve_files;
+    std::string variant = StdVariant::name();
+    std::string serve_path, query_path, query_file, stream_in, stream_out;
+    std::string store_path, export_out;
+    int sample_mask = -1;
+    SampleLimits sample_limits;
+    uint64_t sample_seed = std::chrono::steady_clock::now().time_since_epoch().count();
+    int serve_threads = omp_get_max_threads();
+    int verify_join_stride = 0;
+    bool use_symmetry = true;
+    bool verify_rank = false;
+    bool verify_schedule = false;
+    int left_slots = 2, right_slots = 2;
+    TaskSchedule schedule = TaskSchedule::Plain;
+    int cr_begin = 0, cr_end = sz_cr;
+    std::string checkpoint_path, joint_path;
+    std::vector<std::string> merge_files;
+    bool bench = false;
+    int bench_repeat = 5;
+    std::vector<int> bench_threads;
+    std::string bench_out = "bench.csv";
+    for (int i = 1; i < argc; ++i) {
+        std::string arg = argv[i];
+        if (arg == "--table-dir" && i + 1 < argc) {
+            table_dir = argv[++i];
+        } else if (arg == "--regen") {
+            force_regen = true;
+        } else if (arg == "--numa" && i + 1 < argc) {
+            std::string policy = argv[++i];
+            if (policy == "first-touch") numa_policy = NumaPolicy::FirstTouch;
+            else if (policy == "interleave") numa_policy = NumaPolicy::Interleave;
+            else if (policy == "replicate") numa_policy = NumaPolicy::Replicate;
+            else { std::cerr << "[Error] --numa expects first-touch, interleave or replicate" << std::endl; return 1; }
+        } else if (arg == "--huge-pages" && i + 1 < argc) {
+            std::string mode = argv[++i];
+            if (mode == "off") huge_pages = HugePages::Off;
+            else if (mode == "thp") huge_pages = HugePages::Transparent;
+            else if (mode == "explicit") huge_pages = HugePages::Explicit;
+            else { std::cerr << "[Error] --huge-pages expects off, thp or explicit" << std::endl; return 1; }
+        } else if (arg == "--verify-join" && i + 1 < argc) {
+            // Check every N-th cross state against the reference join
+            verify_join_stride = std::atoi(argv[++i]);
+        } else if (arg == "--slots" && i + 2 < argc) {
+            // Tracked slots: first L of {BL, BR} and first R of {FR, FL}
+            left_slots = std::atoi(argv[++i]);
+            right_slots = std::atoi(argv[++i]);
+            int cfg = left_slots * 10 + right_slots;
+            if (cfg != 10 && cfg != 20 && cfg != 11 && cfg != 21 && cfg != 22) {
+                std::cerr << "[Error] Unsupported slot configuration " << left_slots << " " << right_slots 
+                          << " (use 1 0, 2 0, 1 1, 2 1 or 2 2)" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--schedule" && i + 1 < argc) {
+            // Order of the cross tasks, see schedule_cross_tasks
+            std::string name = argv[++i];
+            if (name == "plain") schedule = TaskSchedule::Plain;
+            else if (name == "paired") schedule = TaskSchedule::Paired;
+            else if (name == "tiled") schedule = TaskSchedule::Tiled;
+            else { std::cerr << "[Error] --schedule expects plain, paired or tiled" << std::endl; return 1; }
+        } else if (arg == "--verify-rank") {
+            verify_rank = true;
+        } else if (arg == "--verify-schedule") {
+            // Aggregate again in plain order and compare the distributions
+            verify_schedule = true;
+        } else if (arg == "--no-sym") {
+            // Visit every cross state instead of one per symmetry class
+            use_symmetry = false;
+        } else if (arg == "--range" && i + 2 < argc) {
+            // Shard: only cross coordinates in [BEGIN, END)
+            cr_begin = std::atoi(argv[++i]);
+            cr_end = std::atoi(argv[++i]);
+            if (cr_begin < 0 || cr_begin > cr_end || cr_end > sz_cr) {
+                std::cerr << "[Error] Invalid cross range [" << cr_begin << ", " << cr_end << "), expected within [0, " << sz_cr << ")" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--joint" && i + 1 < argc) {
+            // Joint histograms (cross / per-slot xcross x final depth) as CSV
+            joint_path = argv[++i];
+        } else if (arg == "--checkpoint" && i + 1 < argc) {
+            // Shard state file: resumed if present, rewritten as the run progresses
+            checkpoint_path = argv[++i];
+        } else if (arg == "--merge" && i + 1 < argc) {
+            while (i + 1 < argc && argv[i + 1][0] != '-') merge_files.push_back(argv[++i]);
+        } else if (arg == "--bench") {
+            bench = true;
+        } else if (arg == "--bench-repeat" && i + 1 < argc) {
+            bench_repeat = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--bench-threads" && i + 1 < argc) {
+            // Comma separated thread counts, e.g. 1,2,4
+            std::string list = argv[++i];
+            for (size_t pos = 0; pos < list.size(); ) {
+                size_t end = list.find(',', pos);
+                if (end == std::string::npos) end = list.size();
+                int n = std::atoi(list.substr(pos, end - pos).c_str());
+                if (n > 0) bench_threads.push_back(n);
+                pos = end + 1;
+            }
+        } else if (arg == "--bench-out" && i + 1 < argc) {
+            // .json for JSON, anything else for CSV
+            bench_out = argv[++i];
+        } else if (arg == "--serve" && i + 1 < argc) {
+            serve_path = argv[++i];
+        } else if (arg == "--threads" && i + 1 < argc) {
+            serve_threads = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--query" && i + 1 < argc) {
+            // Client: --query SOCKET [FILE], reads stdin without FILE
+            query_path = argv[++i];
+            if (i + 1 < argc && argv[i + 1][0] != '-') query_file = argv[++i];
+        } else if (arg == "--variant" && i + 1 < argc) {
+            variant = argv[++i];
+            if (!with_variant(variant, [](auto) {})) {
+                std::cerr << "[Error] --variant expects std, pseudo, eo, pair or pseudo-pair" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--stream" && i + 2 < argc) {
+            // WCA export CSV -> cross_table import CSV
+            stream_in = argv[++i];
+            stream_out = argv[++i];
+        } else if (arg == "--store" && i + 1 < argc) {
+            // Result store for --solve / --stream: known ids are skipped, new ones appended
+            store_path = argv[++i];
+        } else if (arg == "--export" && i + 2 < argc) {
+            store_path = argv[++i];
+            export_out = argv[++i];
+        } else if (arg == "--sample" && i + 1 < argc) {
+            // Monte Carlo estimate for cross + the given slots, e.g. BL,BR,FR,FL
+            sample_mask = parse_slot_mask(argv[++i]);
+            if (sample_mask < 0) {
+                std::cerr << "[Error] --sample expects slots from BL, BR, FR, FL (e.g. BL,BR,FR,FL) or C" << std::endl;
+                return 1;
+            }
+        } else if (arg == "--samples" && i + 1 < argc) {
+            sample_limits.samples = std::max(0LL, std::atoll(argv[++i]));
+        } else if (arg == "--precision" && i + 1 < argc) {
+            // Target 95% half-width in percentage points
+            sample_limits.precision = std::atof(argv[++i]) / 100;
+        } else if (arg == "--time-budget" && i + 1 < argc) {
+            // 0 disables the default budget
+            sample_limits.time_budget = std::max(0.0, std::atof(argv[++i]));
+        } else if (arg == "--seed" && i + 1 < argc) {
+            sample_seed = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--solve" && i + 1 < argc) {
+            // Batch mode: every following non-option argument is an input file
+            while (i + 1 < argc && argv[i + 1][0] != '-') solve_files.push_back(argv[++i]);
+        } else {
+            std::cerr << "Usage: " << argv[0] << " [--table-dir DIR] [--regen] [--numa first-touch|interleave|replicate] [--huge-pages off|thp|explicit]\n"
+                      << "       [--verify-join N] [--verify-rank] [--verify-schedule] [--slots L R] [--no-sym]\n"
+                      << "       [--schedule plain|paired|tiled]\n"
+                      << "       [--range BEGIN END] [--checkpoint FILE] [--merge FILE...] [--joint FILE] [--solve FILE...]\n"
+                      << "       [--variant std|pseudo|eo|pair|pseudo-pair] (pseudo: slots name the edges, paired with any corners)\n"
+                      << "       [--serve SOCKET] [--threads N] [--query SOCKET [FILE]] [--stream IN.csv OUT.csv]\n"
+                      << "       [--store FILE] [--export STORE OUT.csv]\n"
+                      << "       [--sample SLOTS] [--samples N] [--precision PCT] [--time-budget SEC] [--seed N]\n"
+                      << "       [--bench] [--bench-repeat N] [--bench-threads N,N,...] [--bench-out FILE]" << std::endl;
+            return 1;
+        }
+    }
+
+    if (!joint_path.empty() && (cr_begin != 0 || cr_end != sz_cr || !checkpoint_path.empty())) {
+        std::cerr << "[Error] --joint needs a full run (no --range or --checkpoint)" << std::endl;
+        return 1;
+    }
+    if (verify_rank) return verify_ranking() ? 0 : 1;
+    if (!query_path.empty()) return run_query(query_path, query_file);
+
+    if (!export_out.empty()) return export_store(store_path, export_out) ? 0 : 1;
+
+    if (!merge_files.empty()) {
+        long long total_counts[n_depth] = {0};
+        if (!merge_shards(merge_files, total_counts)) return 1;
+        print_distribution(total_counts);
+        return 0;
+    }
+
+    // Pseudo variants read their own pruning tables; pseudo, EO and pair goals have no
+    // distribution mode (the aggregator pairs the corner and edge of one slot)
+    int n_offsets = 1;
+    bool solver_only = false, free_pair = false;
+    with_variant(variant, [&](auto v) {
+        n_offsets = decltype(v)::n_offsets;
+        free_pair = decltype(v)::free_pair;
+        solver_only = decltype(v)::track_eo || free_pair || n_offsets > 1;
+    });
+    if (solver_only && solve_files.empty() && serve_path.empty() && stream_in.empty() && sample_mask < 0) {
+        std::cerr << "[Error] Variant " << variant << " is only available with --solve, --serve, --stream or --sample" << std::endl;
+        return 1;
+    }
+    if (free_pair && sample_mask == 15) {
+        // The free pair must sit in a slot outside the target, and BL,BR,FR,FL leaves none
+        std::cerr << "[Error] Variant " << variant << " needs a slot outside the --sample target for its free pair" << std::endl;
+        return 1;
+    }
+    std::string table_suffix = n_offsets > 1 ? "_pseudo" : "";
+    
+    ResultStore store;
+    if (!store_path.empty()) {
+        if (!store.open(store_path, variant)) return 1;
+        std::cout << "[Init] Result store " << store_path << ": " << store.size() << " scrambles" << std::endl;
+    }
+    ResultStore* store_ptr = store_path.empty() ? nullptr : &store;
+    
+    const char* policy_names[] = {"first-touch", "interleave", "replicate"};
+    const char* huge_names[] = {"off", "thp", "explicit"};
+    std::cout << "[Init] Table memory: " << policy_names[(int)numa_policy] << ", huge pages " 
+              << huge_names[(int)huge_pages] << ", " << numa_node_count() << " NUMA node(s)" << std::endl;
+    std::cout << "[Init] Loading Move Tables..." << std::flush;
+    TICK(init);
+    auto mt_edge = load_or_create_move_table("move_table_edge.bin", 
+        make_table_header(32, 24 * 18, 24, 18, 0, MoveTableEdge), create_edge_move_table);
+    auto mt_corn = load_or_create_move_table("move_table_corner.bin", 
+        make_table_header(32, 24 * 18, 24, 18, 0, MoveTableCorner), create_corner_move_table);
+    auto mt_multi = load_or_create_move_table("move_table_cross.bin", 
+        make_table_header(32, sz_cr * 24, sz_cr, 24, 0, MoveTableCross), 
+        [&]() { return create_multi_move_table(4, 2, 12, sz_cr, mt_edge); });
+    TOCK(init);
+    
+    // Load (or generate) pruning tables for Left and Right sides
+    load_or_generate_table(table_bl, 187520, 12, 0, mt_multi, mt_corn, mt_edge, "BL Table", "prune_table_bl" + table_suffix + ".bin", n_offsets);
+    load_or_generate_table(table_br, 187520, 15, 2, mt_multi, mt_corn, mt_edge, "BR Table", "prune_table_br" + table_suffix + ".bin", n_offsets);
+    
+    TICK(precomp);
+    precompute_cross_y2();
+    TOCK(precomp);
+    
+    if (!serve_path.empty()) {
+        int rc = 1;
+        with_variant(variant, [&](auto v) {
+            generate_solver_tables<decltype(v)>(mt_multi, mt_corn, mt_edge);
+            rc = run_server<decltype(v)>(serve_path, serve_threads, mt_multi, mt_corn, mt_edge);
+        });
+        return rc;
+    }
+    
+    if (!stream_in.empty()) {
+        bool ok = false;
+        with_variant(variant, [&](auto v) {
+            generate_solver_tables<decltype(v)>(mt_multi, mt_corn, mt_edge);
+            ok = run_stream<decltype(v)>(stream_in, stream_out, serve_threads, mt_multi, mt_corn, mt_edge, store_ptr);
+        });
+        std::chrono::duration<double> global_el = std::chrono::high_resolution_clock::now() - global_start;
+        std::cout << "\nTotal Execution Time: " << global_el.count() << "s" << std::endl;
+        return ok ? 0 : 1;
+    }
+    
+    if (sample_mask >= 0) {
+        if (sample_limits.time_budget < 0) sample_limits.time_budget = default_sample_budget;
+        with_variant(variant, [&](auto v) {
+            generate_solver_tables<decltype(v)>(mt_multi, mt_corn, mt_edge);
+            run_sampler<decltype(v)>(sample_mask, sample_limits, sample_seed, serve_threads, mt_multi, mt_corn, mt_edge);
+        });
+        std::chrono::duration<double> global_el = std::chrono::high_resolution_clock::now() - global_start;
+        std::cout << "\nTotal Execution Time: " << global_el.count() << "s" << std::endl;
+        return 0;
+    }
+    
+    if (!solve_files.empty()) {
+        with_variant(variant, [&](auto v) {
+            generate_solver_tables<decltype(v)>(mt_multi, mt_corn, mt_edge);
+            run_batch_solver<decltype(v)>(solve_files, mt_multi, mt_corn, mt_edge, store_ptr);
+        });
+        
+        std::chrono::duration<double> global_el = std::chrono::high_resolution_clock::now() - global_start;
+        std::cout << "\nTotal Execution Time: " << global_el.count() << "s" << std::endl;
+        return 0;
+    }
+    
+    // The aggregation reads the interleaved copy only
+    table_pair.build(table_bl, table_br);
+    table_bl.release();
+    table_br.release();
+    
+    precompute_cross_symmetry(mt_multi);
+    if (!joint_path.empty()) generate_cross_table(mt_multi, n_offsets);
+    int slot_mask = ((1 << left_slots) - 1) | (((1 << right_slots) - 1) << 2);
+    init_cross_tasks(use_symmetry ? slot_stabilizer(slot_mask) : 1, cr_begin, cr_end);
+    schedule_cross_tasks(schedule);
+    long long n_mirrored = std::count(cross_task_mirrors.begin(), cross_task_mirrors.end(), 1);
+    if (schedule == TaskSchedule::Paired && n_mirrored == 0) {
+        // y2 is part of the symmetry reduction here, so no y2 image is a task of its own
+        std::cout << "[Init] Note: no cross task has its y2 image among the tasks (y2 is folded into the symmetry reduction); --schedule "
+                  << "paired falls back to plain. Use --schedule tiled, or --no-sym to pair tasks." << std::endl;
+        schedule = TaskSchedule::Plain;
+        schedule_cross_tasks(schedule);
+    }
+    std::cout << "[Init] Schedule: " << schedule_names[(int)schedule] << " (" << n_mirrored << " tasks follow their y2 image)" << std::endl;
+    
+    if (bench) {
+        if (bench_threads.empty()) {
+            bench_threads.push_back(1);
+            if (omp_get_max_threads() > 1) bench_threads.push_back(omp_get_max_threads());
+        }
+        run_benchmarks(bench_threads, bench_repeat, bench_out, left_slots, right_slots);
+        return 0;
+    }
+    
+    ShardState shard;
+    shard.variant = variant;
+    shard.left_slots = left_slots;
+    shard.right_slots = right_slots;
+    shard.symmetry = use_symmetry;
+    shard.schedule = schedule_names[(int)schedule];
+    shard.cr_begin = cr_begin;
+    shard.cr_end = cr_end;
+    shard.n_tasks = cross_tasks.size();
+    if (!checkpoint_path.empty()) {
+        ShardState saved;
+        if (load_shard(checkpoint_path, saved)) {
+            if (!same_shard_config(saved, shard)) {
+                std::cerr << "[Error] Checkpoint " << checkpoint_path << " was written for a different configuration" << std::endl;
+                return 1;
+            }
+            shard = saved;
+            std::cout << "[Resume] " << checkpoint_path << ": " << shard.next_task << "/" << shard.n_tasks << " tasks done" << std::endl;
+        }
+    }
+    
+    std::cout << "[Step 4] Aggregating Non-Fixed Distribution (High Performance Mode)..." << std::endl;
+    long long verified = 0, mismatches = 0;
+    long long first_task = shard.next_task;
+    std::unique_ptr<JointCounts> joint(joint_path.empty() ? nullptr : new JointCounts());
+#ifdef XCROSS_INSTRUMENT
+    profile_reset();
+#endif
+    
+    TICK(search);
+    
+    // Main Parallel Loop over Cross States, in chunks when checkpointing
+    while (shard.next_task < shard.n_tasks) {
+        long long t_end = checkpoint_path.empty() ? shard.n_tasks : std::min(shard.next_task + shard_chunk, shard.n_tasks);
+        aggregate_tasks(left_slots, right_slots, shard.next_task, t_end, shard.counts, verify_join_stride, verified, mismatches, joint.get());
+        shard.next_task = t_end;
+        if (!checkpoint_path.empty() && !save_shard(checkpoint_path, shard)) {
+            std::cerr << "[Warning] Failed to write checkpoint " << checkpoint_path << std::endl;
         }
     }
     
     // Performance Metrics
     auto search_end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> search_el = search_end - search_start;
-    double throughput = (double)sz_cr / search_el.count();
+    double throughput = (double)(shard.n_tasks - first_task) / search_el.count();
     
     std::cout << "Done. (Search Time: " << search_el.count() << "s, " 
               << "Speed: " << (int)throughput << " iter/s)" << std::endl;
-    
-    std::cout << "\n=== Final Distribution ===" << std::endl;
-    long long grand_total = 0;
-    std::cout.imbue(std::locale(""));
-    
-    long long exact_counts[20] = {0};
-    for(int d = 0; d < 15; ++d) {
-        exact_counts[d] = total_counts[d] - total_counts[d + 1];
+#ifdef XCROSS_INSTRUMENT
+    profile_report(search_el.count());
+    profile_release();
+#endif
+    if (verify_join_stride > 0) {
+        std::cout << "[Verify] Join kernel vs reference: " << verified << " cross states checked, " 
+                  << mismatches << " mismatches" << std::endl;
     }
-    
-    for(int d = 0; d < 15; ++d) {
-        if(exact_counts[d] > 0) {
-            std::cout << d << "\t" << exact_counts[d] << std::endl;
-            grand_total += exact_counts[d];
+    if (verify_schedule && schedule != TaskSchedule::Plain) {
+        long long plain_counts[n_depth] = {0}, unused = 0;
+        // Back to index order, every task on its own
+        std::vector<std::pair<int, long long>> plain(cross_tasks.size());
+        for (size_t t = 0; t < plain.size(); ++t) plain[t] = {cross_tasks[t], cross_weights[t]};
+        std::sort(plain.begin(), plain.end());
+        for (size_t t = 0; t < plain.size(); ++t) {
+            cross_tasks[t] = plain[t].first;
+            cross_weights[t] = plain[t].second;
         }
+        schedule_cross_tasks(TaskSchedule::Plain);
+        aggregate_tasks(left_slots, right_slots, 0, cross_tasks.size(), plain_counts, 0, unused, unused);
+        int differ = 0;
+        for (int d = 0; d < n_depth; ++d) differ += plain_counts[d] != shard.counts[d];
+        std::cout << "[Verify] Schedule " << schedule_names[(int)schedule] << " vs plain: " << differ << " of " << n_depth
+                  << " depths differ" << std::endl;
+        if (differ) return 1;
+    }
+    
+    if (cr_begin != 0 || cr_end != sz_cr) {
+        std::cout << "[Shard] Partial counts for cross [" << cr_begin << ", " << cr_end << "); combine the shard files with --merge" << std::endl;
+    }
+    print_distribution(shard.counts);
+    if (joint) {
+        if (!write_joint_csv(joint_path, *joint, slot_mask)) return 1;
+        std::cout << "[Joint] Histograms written to " << joint_path << std::endl;
     }
     
     auto global_end = std::chrono::high_resolution_clock::now();
     std::chrono::duration<double> global_el = global_end - global_start;
-    std::cout << "total\t" << grand_total << std::endl;
     std::cout << "\nTotal Execution Time: " << global_el.count() << "s" << std::endl;
     
     return 0;